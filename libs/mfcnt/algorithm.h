@@ -0,0 +1,394 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _MMAP_CONTAINERS_MFCNT_ALGORITHM_H
+#define _MMAP_CONTAINERS_MFCNT_ALGORITHM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mfcnt/details/simd.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+// The spans of the char containers are searched by the vectorized kernels,
+// the overloads for char are preferred to the templates for other types.
+
+template<typename TTp, typename TValue>
+const TTp* find_in(const TTp* first, const TTp* last, const TValue& value)
+{
+    return std::find(first, last, value);
+}
+
+inline const char* find_in(const char* first, const char* last, char value)
+{
+    return simd::find(first, last, value);
+}
+
+template<typename TTp, typename TValue>
+ptrdiff_t count_in(const TTp* first, const TTp* last, const TValue& value)
+{
+    return std::count(first, last, value);
+}
+
+inline ptrdiff_t count_in(const char* first, const char* last, char value)
+{
+    return ptrdiff_t(simd::count(first, last, value));
+}
+
+template<typename TTp>
+const TTp* find_first_of_in(const TTp* first, const TTp* last, const TTp* p_set, size_t set_size)
+{
+    return std::find_first_of(first, last, p_set, p_set + set_size);
+}
+
+inline const char* find_first_of_in(const char* first, const char* last, const char* p_set, size_t set_size)
+{
+    return simd::find_first_of(first, last, p_set, set_size);
+}
+
+template<typename TTp>
+const TTp* search_in(const TTp* first, const TTp* last, const TTp* p_needle, size_t needle_size)
+{
+    return std::search(first, last, p_needle, p_needle + needle_size);
+}
+
+inline const char* search_in(const char* first, const char* last, const char* p_needle, size_t needle_size)
+{
+    return simd::search(first, last, p_needle, needle_size);
+}
+
+/// @brief  Split the container into the ranges of whole windows.
+/// @param  cnt   - mmap container.
+/// @param  parts - desired number of the ranges.
+/// @return Bounds of the non-empty ranges, the range i is [bounds[i], bounds[i + 1]).
+template<typename TCnt>
+std::vector<size_t> window_partition(const TCnt& cnt, size_t parts)
+{
+    std::vector<size_t> bounds(1, 0);
+    for (size_t i = 1; i < parts; ++i) {
+        const size_t bound = cnt.window_first(cnt.size() / parts * i);
+        if (bound > bounds.back()) {
+            bounds.push_back(bound);
+        }
+    }
+    if (cnt.size() > bounds.back()) {
+        bounds.push_back(cnt.size());
+    }
+    return bounds;
+}
+
+/// @brief  Run the worker for each range of the partition in its own thread.
+/// @details    Each thread gets its own copy of the container, so the threads
+///             do not share the mapper and the windows of a range are mapped
+///             by one thread only.
+/// @param  cnt    - mmap container.
+/// @param  bounds - bounds of the ranges of the window_partition().
+/// @param  worker - function object (cnt, part, first, last) called for each range.
+/// @throw  The first exception thrown by the workers.
+template<typename TCnt, typename TWorker>
+void run_partition(const TCnt& cnt, const std::vector<size_t>& bounds, const TWorker& worker)
+{
+    const size_t part_count = bounds.size() - 1;
+    if (part_count == 1) {
+        worker(cnt, 0, bounds[0], bounds[1]);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(part_count);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < part_count; ++i) {
+        threads.emplace_back([&cnt, &bounds, &worker, &errors, i]() {
+            try {
+                const TCnt part(cnt);
+                worker(part, i, bounds[i], bounds[i + 1]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    for (const std::exception_ptr& p_error : errors) {
+        if (p_error) {
+            std::rethrow_exception(p_error);
+        }
+    }
+}
+
+/// @brief  Number of the threads of the parallel algorithms, 0 is the number of the hardware threads.
+inline size_t parallel_thread_count(size_t thread_count)
+{
+    thread_count = (thread_count != 0) ? thread_count : std::thread::hardware_concurrency();
+    return (thread_count != 0) ? thread_count : 1;
+}
+
+} // namespace details
+
+/// @brief  Apply the function to each element of the container.
+/// @details    The algorithms of this header iterate the container by the
+///             contiguous spans of its windows, so the inner loop runs over raw
+///             pointers without checking the window bound on each element.
+/// @param  cnt  - mmap container.
+/// @param  func - function object.
+/// @return The function object.
+template<typename TCnt, typename TFunc>
+TFunc for_each(const TCnt& cnt, TFunc func)
+{
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        for (typename TCnt::const_pointer p = seg.begin(); p != seg.end(); ++p) {
+            func(*p);
+        }
+    }
+    return func;
+}
+
+/// @brief  Find the first element equal to the value.
+/// @param  cnt   - mmap container.
+/// @param  value - value to compare the elements to.
+/// @return Iterator to the first element equal to the value or end iterator.
+template<typename TCnt, typename TTp>
+typename TCnt::const_iterator find(const TCnt& cnt, const TTp& value)
+{
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        typename TCnt::const_pointer p_found = details::find_in(seg.begin(), seg.end(), value);
+        if (p_found != seg.end()) {
+            return cnt.cbegin() + (seg.pos + (p_found - seg.begin()));
+        }
+    }
+    return cnt.cend();
+}
+
+/// @brief  Find the first element satisfying the predicate.
+/// @param  cnt  - mmap container.
+/// @param  pred - unary predicate.
+/// @return Iterator to the first element satisfying the predicate or end iterator.
+template<typename TCnt, typename TPred>
+typename TCnt::const_iterator find_if(const TCnt& cnt, TPred pred)
+{
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        typename TCnt::const_pointer p_found = std::find_if(seg.begin(), seg.end(), pred);
+        if (p_found != seg.end()) {
+            return cnt.cbegin() + (seg.pos + (p_found - seg.begin()));
+        }
+    }
+    return cnt.cend();
+}
+
+/// @brief  Find the first element equal to any element of the set.
+/// @param  cnt     - mmap container.
+/// @param  s_first - iterator to the first element of the set.
+/// @param  s_last  - iterator past the last element of the set.
+/// @return Iterator to the first element found or end iterator.
+template<typename TCnt, typename TFwdIt>
+typename TCnt::const_iterator find_first_of(const TCnt& cnt, TFwdIt s_first, TFwdIt s_last)
+{
+    const std::vector<typename TCnt::value_type> set(s_first, s_last);
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        typename TCnt::const_pointer p_found = details::find_first_of_in(seg.begin(), seg.end(),
+                                                                         set.data(), set.size());
+        if (p_found != seg.end()) {
+            return cnt.cbegin() + (seg.pos + (p_found - seg.begin()));
+        }
+    }
+    return cnt.cend();
+}
+
+/// @brief  Find the first occurrence of the sequence of the elements.
+/// @details    The sequence is searched in each span and in the junctions of
+///             the spans, so the occurrences which cross the bounds of the
+///             windows are found too.
+/// @param  cnt     - mmap container.
+/// @param  s_first - iterator to the first element of the sequence.
+/// @param  s_last  - iterator past the last element of the sequence.
+/// @return Iterator to the first element of the occurrence, begin iterator
+///         if the sequence is empty or end iterator if it is not found.
+template<typename TCnt, typename TFwdIt>
+typename TCnt::const_iterator search(const TCnt& cnt, TFwdIt s_first, TFwdIt s_last)
+{
+    typedef typename TCnt::value_type value_type;
+
+    const std::vector<value_type> needle(s_first, s_last);
+    if (needle.empty()) {
+        return cnt.cbegin();
+    }
+
+    // The last elements of the previous spans, the occurrences which start in
+    // them are searched in the junction with the head of the span.
+    const size_t carry_size = needle.size() - 1;
+    std::vector<value_type> carry;
+    std::vector<value_type> junction;
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        if (! carry.empty()) {
+            junction.assign(carry.begin(), carry.end());
+            junction.insert(junction.end(), seg.begin(), seg.begin() + std::min(carry_size, seg.size()));
+            const value_type* p_found = details::search_in(junction.data(), junction.data() + junction.size(),
+                                                           needle.data(), needle.size());
+            if (size_t(p_found - junction.data()) < carry.size()) {
+                return cnt.cbegin() + (seg.pos - carry.size() + (p_found - junction.data()));
+            }
+        }
+
+        typename TCnt::const_pointer p_found = details::search_in(seg.begin(), seg.end(),
+                                                                  needle.data(), needle.size());
+        if (p_found != seg.end()) {
+            return cnt.cbegin() + (seg.pos + (p_found - seg.begin()));
+        }
+
+        carry.insert(carry.end(), seg.end() - std::min(carry_size, seg.size()), seg.end());
+        if (carry.size() > carry_size) {
+            carry.erase(carry.begin(), carry.end() - carry_size);
+        }
+    }
+    return cnt.cend();
+}
+
+/// @brief  Count the elements equal to the value.
+/// @param  cnt   - mmap container.
+/// @param  value - value to compare the elements to.
+/// @return Number of the elements equal to the value.
+template<typename TCnt, typename TTp>
+typename TCnt::difference_type count(const TCnt& cnt, const TTp& value)
+{
+    typename TCnt::difference_type res = 0;
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        res += details::count_in(seg.begin(), seg.end(), value);
+    }
+    return res;
+}
+
+/// @brief  Count the elements satisfying the predicate.
+/// @param  cnt  - mmap container.
+/// @param  pred - unary predicate.
+/// @return Number of the elements satisfying the predicate.
+template<typename TCnt, typename TPred>
+typename TCnt::difference_type count_if(const TCnt& cnt, TPred pred)
+{
+    typename TCnt::difference_type res = 0;
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        res += std::count_if(seg.begin(), seg.end(), pred);
+    }
+    return res;
+}
+
+/// @brief  Fold the elements of the container.
+/// @param  cnt  - mmap container.
+/// @param  init - initial value.
+/// @param  op   - binary operation.
+/// @return Result of the folding.
+template<typename TCnt, typename TTp, typename TBinOp>
+TTp accumulate(const TCnt& cnt, TTp init, TBinOp op)
+{
+    for (const typename TCnt::segment_range::value_type& seg : cnt.segments()) {
+        init = std::accumulate(seg.begin(), seg.end(), std::move(init), op);
+    }
+    return init;
+}
+
+/// @brief  Sum the elements of the container.
+/// @param  cnt  - mmap container.
+/// @param  init - initial value.
+/// @return Sum of the elements and the initial value.
+template<typename TCnt, typename TTp>
+TTp accumulate(const TCnt& cnt, TTp init)
+{
+    return mfcnt::accumulate(cnt, std::move(init), std::plus<TTp>());
+}
+
+/// @brief  Apply the function to each element of the container in several threads.
+/// @details    The container is split into the ranges of whole windows, one per
+///             thread, and each thread reads its range by its own copy of the
+///             container, so the threads do not contend for the windows.
+/// @param  cnt          - mmap container.
+/// @param  func         - function object, called concurrently from the threads.
+/// @param  thread_count - number of the threads, 0 is the number of the hardware threads.
+/// @throw  The first exception thrown by the function or by the copying of the container.
+template<typename TCnt, typename TFunc>
+void parallel_for_each(const TCnt& cnt, TFunc func, size_t thread_count = 0)
+{
+    const std::vector<size_t> bounds = details::window_partition(cnt, details::parallel_thread_count(thread_count));
+    if (bounds.size() < 2) {
+        return;
+    }
+
+    details::run_partition(cnt, bounds, [&func](const TCnt& part, size_t, size_t first, size_t last) {
+        for (const typename TCnt::segment_range::value_type& seg : part.segments(first, last - first)) {
+            for (typename TCnt::const_pointer p = seg.begin(); p != seg.end(); ++p) {
+                func(*p);
+            }
+        }
+    });
+}
+
+/// @brief  Map the elements of the container and fold the results in several threads.
+/// @details    Each thread folds the mapped elements of its range of whole
+///             windows, then the results of the ranges are folded into the
+///             initial value in the order of the ranges, so the operation must
+///             be associative, but need not be commutative.
+/// @param  cnt          - mmap container.
+/// @param  init         - initial value.
+/// @param  map_fn       - unary operation applied to each element, called concurrently.
+/// @param  reduce_fn    - binary operation folding the mapped elements, called concurrently.
+/// @param  thread_count - number of the threads, 0 is the number of the hardware threads.
+/// @return Result of the folding.
+/// @throw  The first exception thrown by the operations or by the copying of the container.
+template<typename TCnt, typename TTp, typename TMapFn, typename TReduceFn>
+TTp parallel_reduce(const TCnt& cnt, TTp init, TMapFn map_fn, TReduceFn reduce_fn, size_t thread_count = 0)
+{
+    const std::vector<size_t> bounds = details::window_partition(cnt, details::parallel_thread_count(thread_count));
+    if (bounds.size() < 2) {
+        return init;
+    }
+
+    std::vector<TTp> partials(bounds.size() - 1, init);
+    details::run_partition(cnt, bounds, [&](const TCnt& part, size_t part_num, size_t first, size_t last) {
+        TTp res = map_fn(part[first]);
+        for (const typename TCnt::segment_range::value_type& seg : part.segments(first + 1, last - first - 1)) {
+            for (typename TCnt::const_pointer p = seg.begin(); p != seg.end(); ++p) {
+                res = reduce_fn(std::move(res), map_fn(*p));
+            }
+        }
+        partials[part_num] = std::move(res);
+    });
+
+    for (TTp& partial : partials) {
+        init = reduce_fn(std::move(init), std::move(partial));
+    }
+    return init;
+}
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_ALGORITHM_H */
@@ -0,0 +1,88 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_DETAILS_HASH_H
+#define _MMAP_CONTAINERS_MFCNT_DETAILS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "mfcnt/types.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+/// @brief  Finalizer of the 64-bit hash, every bit of the input affects every bit of the result.
+inline uint64_t hash_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/// @brief  Hash of the bytes that does not depend on the process and the platform.
+/// @details    The hash is stored in the files, so std::hash which may differ
+///             between the implementations can not be used.
+/// @param  p_data - pointer to the bytes.
+/// @param  size   - number of the bytes.
+/// @param  seed   - seed of the hash.
+inline uint64_t hash_bytes(const void* p_data, size_t size, uint64_t seed)
+{
+    const unsigned char* p_bytes = static_cast<const unsigned char*>(p_data);
+    uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), p_bytes += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, p_bytes, sizeof(word));
+        h = hash_mix(h ^ word) * 0x9e3779b97f4a7c15ULL;
+    }
+    if (size != 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, p_bytes, size);
+        h = hash_mix(h ^ word) * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash_mix(h);
+}
+
+/// @brief  Hash of the keys stored in the files.
+/// @details    The bytes of the key are hashed, so the key should not have
+///             the padding bytes.
+template<typename TKey>
+struct mmap_hash
+{
+    static_assert(std::is_trivially_copyable<TKey>::value, "the key should be trivially copyable");
+
+    uint64_t operator()(const TKey& key, uint64_t seed) const { return hash_bytes(&key, sizeof(key), seed); }
+};
+
+} // namespace details
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_DETAILS_HASH_H */
@@ -26,9 +26,11 @@
 #define _MMAP_CONTAINERS_MFCNT_MMAP_BASE_CONTAINER_H
 
 #include "mfcnt/types.h"
+#include "mfcnt/details/mmap_segments.h"
 #include "mfcnt/details/utils.h"
 
 namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
 namespace details {
 
 template<typename TType, size_t TBufSize, template<typename TTp, size_t TBs> class TIterator>
@@ -42,6 +44,14 @@ protected:
     typedef const value_type&                       const_reference;
     typedef TIterator<value_type, TBufSize>         iterator;
     typedef TIterator<const value_type, TBufSize>   const_iterator;
+    typedef mmap_segment_range<const value_type, TBufSize>  segment_range;
+    typedef mmap_segment<const value_type>                  contiguous_range;
+
+    static_assert(! (TBufSize & (TBufSize - 1)), "mmap_base_container: number of elements in the window must be a power of two");
+
+    /// Shift and mask to split the position into the window number and the offset in the window.
+    static constexpr size_t s_buf_shift = utils::ilog2(TBufSize);
+    static constexpr size_t s_buf_mask = TBufSize - 1;
 
     /// @brief  Constructor.
     mmap_base_container()
@@ -59,17 +69,22 @@ protected:
     /// @param  mmap_flags - determines whether updates to the mapping are visible to other
     ///                      processes mapping the same region, and whether updates are carried
     ///                      through to the underlying file.
-    mmap_base_container(const std::string& file_path, off64_t offset, mode m)
+    /// @param  policy     - policy of mapping the file to memory.
+    /// @param  adv        - access pattern hint.
+    /// @param  pages      - size of the pages the mappings are aligned with.
+    mmap_base_container(const std::string& file_path, off64_t offset, mode m, map_policy policy, advice adv,
+                        page_policy pages)
         : m_buffer(file_path, m)
-        , m_size(m_buffer.file_size())
-        , m_begin_delta(offset % utils::memory_page_size())
-        , m_mmap_size(m_size + m_begin_delta)
+        , m_size(0)
+        , m_begin_delta(0)
+        , m_mmap_size(0)
     {
         assert(m_buffer.is_open());
-        assert(! (TBufSize % utils::memory_page_size()));
-        assert(! (m_size % sizeof(value_type)));
 
-        m_buffer.opts.offset = offset - m_begin_delta;
+        const size_t file_size = m_buffer.file_size();
+        assert(size_t(offset) <= file_size);
+
+        init(file_size - offset, offset, policy, adv, pages);
     }
 
     /// @brief  Constructor.
@@ -82,17 +97,19 @@ protected:
     /// @param  mmap_flags - determines whether updates to the mapping are visible to other
     ///                      processes mapping the same region, and whether updates are carried
     ///                      through to the underlying file.
-    mmap_base_container(const std::string& file_path, size_t size, off64_t offset, mode m)
+    /// @param  policy     - policy of mapping the file to memory.
+    /// @param  adv        - access pattern hint.
+    /// @param  pages      - size of the pages the mappings are aligned with.
+    mmap_base_container(const std::string& file_path, size_t size, off64_t offset, mode m, map_policy policy,
+                        advice adv, page_policy pages)
         : m_buffer(file_path, m)
-        , m_size(size)
-        , m_begin_delta(offset % utils::memory_page_size())
-        , m_mmap_size(m_size + m_begin_delta)
+        , m_size(0)
+        , m_begin_delta(0)
+        , m_mmap_size(0)
     {
         assert(m_buffer.is_open());
-        assert(! (TBufSize % utils::memory_page_size()));
-        assert(! (m_size % sizeof(value_type)));
 
-        m_buffer.opts.offset = offset - m_begin_delta;
+        init(size, offset, policy, adv, pages);
     }
 
     /// @brief  Copy constructor.
@@ -103,8 +120,7 @@ protected:
         , m_mmap_size(orig.m_mmap_size)
     {
         assert(m_buffer.is_open());
-        assert(! (TBufSize % utils::memory_page_size()));
-        assert(! (m_size % sizeof(value_type)));
+        assert(! (m_buffer.buf_bytes % utils::memory_page_size()));
     }
 
     /// @brief  Move constructor.
@@ -128,6 +144,17 @@ protected:
         m_size = 0;
     }
 
+    /// @brief  Set the access pattern hint for the container.
+    void advise(advice adv) { m_buffer.advise(adv); }
+
+    /// @brief  Set the access pattern hint for the elements [pos, pos + count).
+    void advise(advice adv, size_t pos, size_t count) const
+    {
+        assert(pos + count <= m_size);
+        m_buffer.advise(adv, (pos + m_begin_delta) * sizeof(value_type),
+                        (pos + count + m_begin_delta) * sizeof(value_type));
+    }
+
     /// @brief  Сheck for exceeding the permissible range.
     /// @throw  std::runtime_error if the value exceeds the permissible limits.
     inline void check_range(size_t pos) const
@@ -142,6 +169,28 @@ protected:
         }
     }
 
+    /// @brief  Pointer to the contiguous mapping of the elements.
+    /// @return Pointer to the first element if the whole range is mapped,
+    ///         nullptr otherwise.
+    inline pointer data() const
+    {
+        return (m_buffer.p_whole) ? m_buffer.p_whole + m_begin_delta : nullptr;
+    }
+
+    /// @brief  Range of the pointers over the contiguous mapping of the elements.
+    /// @return The range of all elements if the whole range is mapped, the empty range otherwise.
+    inline contiguous_range make_contiguous() const
+    {
+        const pointer p_first = data();
+        return contiguous_range{p_first, p_first ? p_first + m_size : nullptr, 0};
+    }
+
+    /// @brief  Read the pages of the container into memory.
+    void eager_load(load_policy policy, size_t thread_count, bool lock) const
+    {
+        m_buffer.eager_load(m_mmap_size, policy, thread_count, lock);
+    }
+
     /// @brief  Get value by position.
     /// @param  pos - position.
     /// @return Element reference.
@@ -150,10 +199,59 @@ protected:
         assert(m_buffer.is_open() && "get_value: file is not open");
 
         pos += m_begin_delta;
-        pointer p_page = m_buffer.map(pos / TBufSize);
-        return *(p_page + (pos % TBufSize));
+        if (m_buffer.p_whole) {
+            return *(m_buffer.p_whole + pos);
+        }
+        pointer p_page = m_buffer.map(pos >> s_buf_shift);
+        return *(p_page + (pos & s_buf_mask));
+    }
+
+    /// @brief  Create range of the contiguous spans of the elements.
+    /// @param  pos   - position of the first element.
+    /// @param  count - number of the elements.
+    inline segment_range make_segments(size_t pos, size_t count) const
+    {
+        assert(pos + count <= m_size);
+        return segment_range(m_buffer, pos + m_begin_delta, pos + count + m_begin_delta, m_begin_delta);
+    }
+
+    /// @brief  Create iterator by position.
+    /// @param  pos - position.
+    /// @return Iterator of the TIt type.
+    template<typename TIt>
+    inline TIt make_iterator(size_t pos) const
+    {
+        const size_t map_pos = pos + m_begin_delta;
+        return TIt(m_buffer, map_pos >> s_buf_shift, map_pos & s_buf_mask, pos);
     }
 
+    void reset_stats() { m_buffer.counters.reset(); }
+
+    /// @brief  Set the read-ahead of the next window during the sequential iteration.
+    /// @param  fraction - fraction of the window in the range [0, 1], 0 disables the read-ahead.
+    void set_prefetch(double fraction)
+    {
+        assert(fraction >= 0.0 && fraction <= 1.0);
+
+        const size_t pos = size_t(fraction * TBufSize);
+        m_buffer.prefetch_pos = (fraction > 0.0 && pos == 0) ? 1 : pos;
+    }
+
+    /// @brief  Set the number of windows of the file kept mapped at the same time.
+    /// @param  count - number of windows, must be greater than zero.
+    void set_window_count(size_t count) { m_buffer.set_window_count(count); }
+
+    size_t window_count() const { return m_buffer.window_count(); }
+
+    /// @brief  Position of the first element of the window which contains the element.
+    inline size_t window_first(size_t pos) const
+    {
+        const size_t map_first = (pos + m_begin_delta) & ~s_buf_mask;
+        return (map_first > m_begin_delta) ? map_first - m_begin_delta : 0;
+    }
+
+    mfcnt::stats stats() const { return m_buffer.counters.get(); }
+
     void swap(mmap_base_container& orig)
     {
         if (this == &orig) {
@@ -165,6 +263,72 @@ protected:
         std::swap(m_mmap_size, orig.m_mmap_size);
     }
 
+private:
+    /// @brief  Initialize the geometry of the container.
+    /// @param  size   - the size of the file to be mapped to memory in bytes.
+    /// @param  offset - offset to start mapping the file.
+    /// @param  policy - policy of mapping the file to memory.
+    /// @param  adv    - access pattern hint.
+    /// @param  pages  - size of the pages the mappings are aligned with.
+    void init(size_t size, off64_t offset, map_policy policy, advice adv, page_policy pages)
+    {
+        assert(! (m_buffer.buf_bytes % utils::memory_page_size()));
+        assert(! (size % sizeof(value_type)));
+
+        if (policy != map_policy::WHOLE_FILE && (m_buffer.buf_bytes % m_buffer.page_bytes)) {
+            m_buffer.close();
+            throw std::runtime_error("mmap_base_container: window size (which is " + std::to_string(m_buffer.buf_bytes)
+                                     + ") is not a multiple of the huge page size of the file (which is "
+                                     + std::to_string(m_buffer.page_bytes) + "), use map_policy::WHOLE_FILE");
+        }
+
+        const size_t delta = page_delta(offset);
+        m_buffer.opts.offset = offset - delta;
+        m_buffer.opts.pages = pages;
+
+        m_size = size / sizeof(value_type);
+        m_begin_delta = delta / sizeof(value_type);
+        m_mmap_size = size + delta;
+
+        if (policy == map_policy::WHOLE_FILE && m_mmap_size != 0) {
+            m_buffer.map_whole(m_mmap_size);
+        } else if (policy == map_policy::CONCURRENT
+                   && m_mmap_size / m_buffer.chunk_bytes >= utils::kMaxConcurrentChunkCount) {
+            if (! m_buffer.map_whole(m_mmap_size)) {
+                m_buffer.close();
+                throw std::runtime_error("mmap_base_container: the range (which is " + std::to_string(m_mmap_size)
+                                         + " bytes) is too large for map_policy::CONCURRENT");
+            }
+        }
+        m_buffer.map_chunks(m_mmap_size);
+        m_buffer.concurrent = (policy == map_policy::CONCURRENT);
+        if (adv != advice::NORMAL) {
+            m_buffer.advise(adv);
+        }
+    }
+
+    /// @brief  Calculate the distance in bytes from the start of the mapping to the offset.
+    /// @details    The start of the mapping is aligned with the page of the file and
+    ///             the distance is a multiple of the element size, so the windows
+    ///             contain whole elements.
+    /// @throw  std::runtime_error if the offset can not be aligned. Before throwing
+    ///         an exception, the file will be closed.
+    size_t page_delta(off64_t offset)
+    {
+        const size_t page_size = m_buffer.page_bytes;
+
+        size_t delta = offset % page_size;
+        for (size_t i = 0; i < sizeof(value_type) && delta <= size_t(offset); ++i, delta += page_size) {
+            if (! (delta % sizeof(value_type))) {
+                return delta;
+            }
+        }
+
+        m_buffer.close();
+        throw std::runtime_error("mmap_base_container: offset (which is " + std::to_string(offset)
+                                 + ") can not be aligned with the memory page and the element size");
+    }
+
 protected:
     utils::mmap_buffer<pointer, TBufSize> m_buffer;
     size_t m_size;
@@ -173,6 +337,7 @@ protected:
 };
 
 } // namespace details
+MFCNT_INLINE_NAMESPACE_END
 } // namespace mfcnt
 
 #endif /* _MMAP_CONTAINERS_MFCNT_MMAP_BASE_CONTAINER_H */
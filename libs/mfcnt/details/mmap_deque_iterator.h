@@ -28,19 +28,27 @@
 #include <cassert>
 #include <cstddef>
 #include <iterator>
-#include <memory>
 #include <type_traits>
 
 #include "mfcnt/details/utils.h"
 
 namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
 namespace details {
 
+/// @brief  Random access iterator over the windows of the table of chunks.
+/// @details    The iterator is a plain value, so the copies are cheap and
+///             share nothing. The segmented container may unmap the chunk the
+///             iterator points to after kLiveChunkCount other chunks have been
+///             mapped; the iterator compares the generation of the chunk on
+///             the dereference and maps the chunk again, so the references
+///             obtained earlier are invalidated, but the iterator stays valid.
 template<typename TTp, size_t TBufSize>
 class mmap_deque_iterator
 {
     typedef typename std::conditional<std::is_const<TTp>::value, typename std::remove_cv<TTp>::type, TTp>::type _type;
     typedef _type* _raw_ptr;
+    typedef utils::mmap_buffer<_raw_ptr, TBufSize> _mapper;
 
 public:
     typedef std::random_access_iterator_tag         iterator_category;
@@ -51,82 +59,86 @@ public:
     typedef ptrdiff_t                               difference_type;
 
     mmap_deque_iterator()
-        : m_p_opts(NULL)
+        : m_p_mapper(NULL)
         , m_p_first(NULL)
         , m_p_last(NULL)
+        , m_p_stop(NULL)
         , m_p_cur(NULL)
         , m_buf_num(0)
         , m_pos(0)
+        , m_p_gen(NULL)
+        , m_gen(0)
     {}
 
-    mmap_deque_iterator(const utils::mmap_buffer<_raw_ptr, TBufSize>& buf_mapper, size_t buf_num, size_t pos)
-        : m_p_opts(&buf_mapper.opts)
+    mmap_deque_iterator(const _mapper& buf_mapper, size_t buf_num, size_t cur, size_t pos)
+        : m_p_mapper(&buf_mapper)
+        , m_p_first(NULL)
+        , m_p_last(NULL)
+        , m_p_stop(NULL)
+        , m_p_cur(NULL)
         , m_buf_num(buf_num)
         , m_pos(pos)
+        , m_p_gen(NULL)
+        , m_gen(0)
     {
-        if (m_p_opts->fd != -1) {
-            change_buf(m_buf_num, pos % TBufSize);
+        if (m_p_mapper->is_open()) {
+            change_buf(m_buf_num, cur);
         }
     }
 
-    mmap_deque_iterator(const mmap_deque_iterator& it)
-        : m_p_opts(it.m_p_opts)
-        , m_p_buf(it.m_p_buf)
-        , m_p_first(it.m_p_first)
-        , m_p_last(it.m_p_last)
-        , m_p_cur(it.m_p_cur)
-        , m_buf_num(it.m_buf_num)
-        , m_pos(it.m_pos)
-    {
-        assert(m_p_opts->fd != -1);
-        assert(m_p_opts != nullptr);
-    }
-
     template<class T, typename = typename std::enable_if<! std::is_const<T>::value && std::is_same<const T, TTp>::value>::type>
     mmap_deque_iterator(const mmap_deque_iterator<T, TBufSize>& it)
-        : m_p_opts(it.m_p_opts)
-        , m_p_buf(it.m_p_buf)
+        : m_p_mapper(it.m_p_mapper)
         , m_p_first(it.m_p_first)
         , m_p_last(it.m_p_last)
+        , m_p_stop(it.m_p_stop)
         , m_p_cur(it.m_p_cur)
         , m_buf_num(it.m_buf_num)
         , m_pos(it.m_pos)
+        , m_p_gen(it.m_p_gen)
+        , m_gen(it.m_gen)
     {
-        assert(m_p_opts->fd != -1);
-        assert(m_p_opts != nullptr);
+        assert(m_p_mapper != nullptr);
+        assert(m_p_mapper->is_open());
     }
 
     reference operator*() const
     {
-        assert(m_p_opts != nullptr);
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper != nullptr);
+        assert(m_p_mapper->is_open());
         assert(m_p_cur && m_p_cur != m_p_last);
+        if (*m_p_gen != m_gen) {
+            remap_buf();
+        }
         return *m_p_cur;
     }
 
     pointer operator->() const
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
         assert(m_p_cur && m_p_cur != m_p_last);
+        if (*m_p_gen != m_gen) {
+            remap_buf();
+        }
         return m_p_cur;
     }
 
     mmap_deque_iterator& operator++()
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
         assert(m_p_cur && m_p_cur != m_p_last);
 
         ++m_p_cur;
         ++m_pos;
-        if (m_p_cur == m_p_last) {
-            change_buf(++m_buf_num, 0);
+        if (m_p_cur == m_p_stop) {
+            stop();
         }
         return *this;
     }
 
     mmap_deque_iterator operator++(int)
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
 
         mmap_deque_iterator tmp = *this;
         this->operator++();
@@ -135,12 +147,16 @@ public:
 
     mmap_deque_iterator& operator+=(difference_type n)
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
 
         m_pos += n;
         const difference_type offset = n + (m_p_cur - m_p_first);
         if ((offset >= 0) && (offset < difference_type(TBufSize))) {
             m_p_cur += n;
+            if (m_p_cur >= m_p_stop) {
+                // The read-ahead point is skipped.
+                m_p_stop = m_p_last;
+            }
         } else {
             const difference_type node_offset = (offset > 0) ? (offset / difference_type(TBufSize)) : (-difference_type((-offset - 1) / TBufSize) - 1);
             m_buf_num += node_offset;
@@ -151,7 +167,7 @@ public:
 
     mmap_deque_iterator operator+(difference_type n)
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
 
         mmap_deque_iterator tmp = *this;
         tmp += n;
@@ -160,7 +176,7 @@ public:
 
     mmap_deque_iterator& operator--()
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
         assert(m_pos != 0);
 
         if (m_p_cur == m_p_first) {
@@ -173,7 +189,7 @@ public:
 
     mmap_deque_iterator operator--(int)
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
 
         mmap_deque_iterator tmp = *this;
         this->operator--();
@@ -182,47 +198,34 @@ public:
 
     mmap_deque_iterator& operator-=(difference_type n)
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
 
         return *this += -n;
     }
 
     mmap_deque_iterator operator-(difference_type n)
     {
-        assert(m_p_opts->fd != -1);
+        assert(m_p_mapper->is_open());
 
         mmap_deque_iterator tmp = *this;
         tmp -= n;
         return tmp;
     }
 
-    mmap_deque_iterator& operator=(const mmap_deque_iterator& it)
-    {
-        //assert(it.m_p_opts->fd != -1);
-
-        m_p_opts = it.m_p_opts;
-        m_p_buf = it.m_p_buf;
-        m_p_first = it.m_p_first;
-        m_p_last = it.m_p_last;
-        m_p_cur = it.m_p_cur;
-        m_buf_num = it.m_buf_num;
-        m_pos = it.m_pos;
-
-        return *this;
-    }
-
     template<class T, typename = typename std::enable_if<! std::is_const<T>::value && std::is_same<const T, TTp>::value>::type>
     mmap_deque_iterator& operator=(const mmap_deque_iterator<T, TBufSize>& it)
     {
-        //assert(it.m_p_opts->fd != -1);
+        //assert(it.m_p_mapper->is_open());
 
-        m_p_opts = it.m_p_opts;
-        m_p_buf = it.m_p_buf;
+        m_p_mapper = it.m_p_mapper;
         m_p_first = it.m_p_first;
         m_p_last = it.m_p_last;
+        m_p_stop = it.m_p_stop;
         m_p_cur = it.m_p_cur;
         m_buf_num = it.m_buf_num;
         m_pos = it.m_pos;
+        m_p_gen = it.m_p_gen;
+        m_gen = it.m_gen;
 
         return *this;
     }
@@ -230,69 +233,97 @@ public:
 private:
     inline void change_buf(const size_t buf_num, const size_t cur_pos)
     {
-        assert(m_p_opts->fd != -1);
-
-        m_p_buf.reset((_raw_ptr)utils::mmap_buf(nullptr, TBufSize, *m_p_opts, buf_num * TBufSize), buf_deleter);
+        assert(m_p_mapper->is_open());
 
-        assert(m_p_opts->fd != -1);
+        m_p_mapper->counters.on_buf_change();
 
-        m_p_first = m_p_buf.get();
+        m_p_first = m_p_mapper->map_persistent(buf_num);
+        m_p_gen = m_p_mapper->chunk_gen(buf_num);
+        m_gen = *m_p_gen;
         m_p_last = m_p_first + TBufSize;
         m_p_cur = m_p_first + cur_pos;
+
+        const size_t prefetch_pos = m_p_mapper->prefetch_pos;
+        m_p_stop = (prefetch_pos != 0 && cur_pos < prefetch_pos) ? m_p_first + prefetch_pos : m_p_last;
+    }
+
+    /// @brief  Handle the stop point of the sequential iteration: either
+    ///         read the next window ahead or switch to the next window.
+    inline void stop()
+    {
+        if (m_p_cur == m_p_last) {
+            change_buf(++m_buf_num, 0);
+        } else {
+            m_p_mapper->prefetch(m_buf_num + 1);
+            m_p_stop = m_p_last;
+        }
     }
-    
-    static void buf_deleter(_raw_ptr p_buf)
+
+    /// @brief  Map the window again at the same position after the container
+    ///         has unmapped its chunk.
+    void remap_buf() const
     {
-        utils::munmap_buf(p_buf, TBufSize);
+        const size_t cur_pos = m_p_cur - m_p_first;
+        const size_t stop_pos = m_p_stop - m_p_first;
+
+        m_p_first = m_p_mapper->map_persistent(m_buf_num);
+        m_gen = *m_p_gen;
+        m_p_last = m_p_first + TBufSize;
+        m_p_cur = m_p_first + cur_pos;
+        m_p_stop = m_p_first + stop_pos;
     }
 
 public:
-    const utils::mmap_options* m_p_opts;
-    std::shared_ptr<_type> m_p_buf;
-    _raw_ptr m_p_first;
-    _raw_ptr m_p_last;
-    _raw_ptr m_p_cur;
+    const _mapper* m_p_mapper;
+    mutable _raw_ptr m_p_first;
+    mutable _raw_ptr m_p_last;
+    mutable _raw_ptr m_p_stop;
+    mutable _raw_ptr m_p_cur;
     size_t   m_buf_num;
     size_t   m_pos;
+
+    /// Generation of the chunk of the window and its value when the window was mapped.
+    const size_t* m_p_gen;
+    mutable size_t m_gen;
 };
 
 template<typename TTp, size_t TBufSize>
 inline bool operator==(const mmap_deque_iterator<TTp, TBufSize>& lhl, const mmap_deque_iterator<TTp, TBufSize>& rhl)
 {
-    assert(lhl.m_p_opts == rhl.m_p_opts);
-    return (lhl.m_pos == rhl.m_pos) && (lhl.m_p_opts == rhl.m_p_opts);
+    assert(lhl.m_p_mapper == rhl.m_p_mapper);
+    return (lhl.m_pos == rhl.m_pos) && (lhl.m_p_mapper == rhl.m_p_mapper);
 }
 
 template<typename TTp, size_t TBufSize>
 inline bool operator==(const mmap_deque_iterator<TTp, TBufSize>& lhl, const mmap_deque_iterator<const TTp, TBufSize>& rhl)
 {
-    assert(lhl.m_p_opts == rhl.m_p_opts);
-    return (lhl.m_pos == rhl.m_pos) && (lhl.m_p_opts == rhl.m_p_opts);
+    assert(lhl.m_p_mapper == rhl.m_p_mapper);
+    return (lhl.m_pos == rhl.m_pos) && (lhl.m_p_mapper == rhl.m_p_mapper);
 }
 
 template<typename TTp, size_t TBufSize>
 inline bool operator==(const mmap_deque_iterator<const TTp, TBufSize>& lhl, const mmap_deque_iterator<TTp, TBufSize>& rhl)
 {
-    assert(lhl.m_p_opts == rhl.m_p_opts);
-    return (lhl.m_pos == rhl.m_pos) && (lhl.m_p_opts == rhl.m_p_opts);
+    assert(lhl.m_p_mapper == rhl.m_p_mapper);
+    return (lhl.m_pos == rhl.m_pos) && (lhl.m_p_mapper == rhl.m_p_mapper);
 }
 
 template<typename TTp, size_t TBufSize>
 inline bool operator!=(const mmap_deque_iterator<TTp, TBufSize>& lhl, const mmap_deque_iterator<TTp, TBufSize>& rhl)
 {
-    return (lhl.m_pos != rhl.m_pos) || (lhl.m_p_opts != rhl.m_p_opts);
+    return (lhl.m_pos != rhl.m_pos) || (lhl.m_p_mapper != rhl.m_p_mapper);
 }
 
 template<typename TTp, size_t TBufSize>
 inline bool operator!=(const mmap_deque_iterator<TTp, TBufSize>& lhl, const mmap_deque_iterator<const TTp, TBufSize>& rhl)
 {
-    return (lhl.m_pos != rhl.m_pos) || (lhl.m_p_opts != rhl.m_p_opts);
+    return (lhl.m_pos != rhl.m_pos) || (lhl.m_p_mapper != rhl.m_p_mapper);
 }
 
 template<typename TTp, size_t TBufSize>
 inline bool operator!=(const mmap_deque_iterator<const TTp, TBufSize>& lhl, const mmap_deque_iterator<TTp, TBufSize>& rhl)
 {
-    return (lhl.m_pos != rhl.m_pos) || (lhl.m_p_opts != rhl.m_p_opts);
+    return (lhl.m_pos != rhl.m_pos) || (lhl.m_p_mapper != rhl.m_p_mapper);
 }
 
 template<typename TTp, size_t TBufSize>
@@ -386,6 +417,7 @@ inline mmap_deque_iterator<TTp, TBufSize> operator+(ptrdiff_t n, const mmap_dequ
 }
 
 } // namespace details
+MFCNT_INLINE_NAMESPACE_END
 } // namespace mfcnt
 
 #endif /* _MMAP_CONTAINERS_MFCNT_MMAP_DEQUE_ITERATOR_H */
@@ -34,6 +34,7 @@
 #include "mfcnt/details/utils.h"
 
 namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
 namespace details {
 
 template<typename TTp, size_t TBufSize>
@@ -41,6 +42,7 @@ class mmap_list_iterator
 {
     typedef typename std::conditional<std::is_const<TTp>::value, typename std::remove_cv<TTp>::type, TTp>::type _type;
     typedef _type* _raw_ptr;
+    typedef utils::mmap_buffer<_raw_ptr, TBufSize> _mapper;
 
 public:
     typedef std::random_access_iterator_tag         iterator_category;
@@ -57,9 +59,9 @@ public:
         , m_pos(0)
     {}
 
-    mmap_list_iterator(const utils::mmap_buffer<_raw_ptr, TBufSize>& buf_mapper, size_t buf_num, size_t pos)
+    mmap_list_iterator(const _mapper& buf_mapper, size_t buf_num, size_t cur, size_t pos)
         : m_p_mapper(&buf_mapper)
-        , m_cur(pos % TBufSize)
+        , m_cur(cur)
         , m_buf_num(buf_num)
         , m_pos(pos)
     {}
@@ -179,7 +181,7 @@ public:
     }
 
 public:
-    const utils::mmap_buffer<_raw_ptr, TBufSize>* m_p_mapper;
+    const _mapper* m_p_mapper;
     size_t m_cur;
     size_t m_buf_num;
     size_t m_pos;
@@ -315,6 +317,7 @@ inline mmap_list_iterator<TTp, TBufSize> operator+(ptrdiff_t n, const mmap_list_
 }
 
 } // namespace details
+MFCNT_INLINE_NAMESPACE_END
 } // namespace mfcnt
 
 #endif /* _MMAP_CONTAINERS_MFCNT_MMAP_LIST_ITERATOR_H */
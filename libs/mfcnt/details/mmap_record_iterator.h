@@ -0,0 +1,121 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_RECORD_ITERATOR_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_RECORD_ITERATOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+
+#include "mfcnt/types.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+/// @brief  Input iterator over the records of mmap_record_view.
+/// @details    The record is read when the iterator is created or incremented,
+///             so dereferencing does not touch the mapping. The payload of
+///             the record points into the window of the view, which is
+///             replaced when other records are read, so the iteration is
+///             single pass and the record is valid until the next one is read.
+template<typename TView>
+class mmap_record_iterator
+{
+public:
+    typedef std::input_iterator_tag                 iterator_category;
+    typedef typename TView::record_type             value_type;
+    typedef const value_type*                       pointer;
+    typedef const value_type&                       reference;
+    typedef size_t                                  size_type;
+    typedef ptrdiff_t                               difference_type;
+
+    mmap_record_iterator()
+        : m_p_view(NULL)
+        , m_offset(0)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  view   - view of the records.
+    /// @param  offset - offset of the length prefix of the record in the view.
+    mmap_record_iterator(const TView& view, size_t offset)
+        : m_p_view(&view)
+        , m_offset(offset)
+    {
+        if (m_offset < m_p_view->bytes()) {
+            m_record = m_p_view->read(m_offset);
+        }
+    }
+
+    reference operator*() const { return m_record; }
+
+    pointer operator->() const { return &m_record; }
+
+    mmap_record_iterator& operator++()
+    {
+        assert(m_p_view != NULL);
+        assert(m_offset < m_p_view->bytes());
+
+        m_offset = m_record.pos() + m_record.size();
+        if (m_offset < m_p_view->bytes()) {
+            m_record = m_p_view->read(m_offset);
+        }
+        return *this;
+    }
+
+    mmap_record_iterator operator++(int)
+    {
+        mmap_record_iterator tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    /// @brief  Offset of the length prefix of the current record in the view.
+    size_type offset() const { return m_offset; }
+
+public:
+    const TView* m_p_view;
+    size_t m_offset;
+    value_type m_record;
+};
+
+template<typename TView>
+inline bool operator==(const mmap_record_iterator<TView>& lhl, const mmap_record_iterator<TView>& rhl)
+{
+    assert(lhl.m_p_view == rhl.m_p_view);
+    return (lhl.m_offset == rhl.m_offset) && (lhl.m_p_view == rhl.m_p_view);
+}
+
+template<typename TView>
+inline bool operator!=(const mmap_record_iterator<TView>& lhl, const mmap_record_iterator<TView>& rhl)
+{
+    return ! (lhl == rhl);
+}
+
+} // namespace details
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_RECORD_ITERATOR_H */
@@ -0,0 +1,187 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_SEGMENTS_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_SEGMENTS_H
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include "mfcnt/details/utils.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+/// @brief  Contiguous span of the elements that lie in one window of the file.
+template<typename TTp>
+struct mmap_segment
+{
+    typedef TTp         value_type;
+    typedef TTp*        pointer;
+    typedef TTp*        iterator;
+    typedef size_t      size_type;
+
+    iterator begin() const { return first; }
+
+    iterator end() const { return last; }
+
+    size_type size() const { return last - first; }
+
+    /// Pointer to the first element of the span.
+    pointer first;
+
+    /// Pointer past the last element of the span.
+    pointer last;
+
+    /// Position of the first element of the span in the container.
+    size_type pos;
+};
+
+template<typename TTp, size_t TBufSize>
+class mmap_segment_iterator
+{
+    typedef typename std::remove_cv<TTp>::type _type;
+    typedef _type* _raw_ptr;
+    typedef utils::mmap_buffer<_raw_ptr, TBufSize> _mapper;
+
+public:
+    typedef std::input_iterator_tag                 iterator_category;
+    typedef mmap_segment<TTp>                       value_type;
+    typedef const mmap_segment<TTp>*                pointer;
+    typedef mmap_segment<TTp>                       reference;
+    typedef ptrdiff_t                               difference_type;
+
+    mmap_segment_iterator()
+        : m_p_mapper(NULL)
+        , m_buf_num(0)
+        , m_first(0)
+        , m_last(0)
+        , m_delta(0)
+    {}
+
+    /// @param  buf_mapper - mapper of the container.
+    /// @param  buf_num    - number of the window of the segment.
+    /// @param  first      - position of the first element of the range in the mapping.
+    /// @param  last       - position past the last element of the range in the mapping.
+    /// @param  delta      - distance from the start of the mapping to the first element
+    ///                      of the container.
+    mmap_segment_iterator(const _mapper& buf_mapper, size_t buf_num, size_t first, size_t last, size_t delta)
+        : m_p_mapper(&buf_mapper)
+        , m_buf_num(buf_num)
+        , m_first(first)
+        , m_last(last)
+        , m_delta(delta)
+    {}
+
+    /// @brief  Map the window and get the span of the range in it.
+    /// @note   The span remains valid until the window is evicted by the mapper.
+    reference operator*() const
+    {
+        assert(m_p_mapper != NULL);
+        assert(m_p_mapper->is_open());
+
+        const size_t buf_first = m_buf_num * TBufSize;
+        const size_t first = (m_first > buf_first) ? m_first : buf_first;
+        const size_t last = (m_last < buf_first + TBufSize) ? m_last : buf_first + TBufSize;
+        assert(first < last);
+
+        _raw_ptr p_buf = m_p_mapper->map(m_buf_num) - buf_first;
+
+        reference seg;
+        seg.first = p_buf + first;
+        seg.last = p_buf + last;
+        seg.pos = first - m_delta;
+        return seg;
+    }
+
+    mmap_segment_iterator& operator++()
+    {
+        ++m_buf_num;
+        return *this;
+    }
+
+    mmap_segment_iterator operator++(int)
+    {
+        mmap_segment_iterator tmp = *this;
+        this->operator++();
+        return tmp;
+    }
+
+    bool operator==(const mmap_segment_iterator& it) const
+    {
+        return (m_buf_num == it.m_buf_num) && (m_p_mapper == it.m_p_mapper);
+    }
+
+    bool operator!=(const mmap_segment_iterator& it) const { return ! (*this == it); }
+
+private:
+    const _mapper* m_p_mapper;
+    size_t m_buf_num;
+    size_t m_first;
+    size_t m_last;
+    size_t m_delta;
+};
+
+/// @brief  Range of the contiguous spans of the container, one per window.
+/// @details    Algorithms run the inner loop over the raw pointers of each
+///             span instead of checking the window bound on each element.
+template<typename TTp, size_t TBufSize>
+class mmap_segment_range
+{
+    typedef typename std::remove_cv<TTp>::type _type;
+    typedef utils::mmap_buffer<_type*, TBufSize> _mapper;
+
+public:
+    typedef mmap_segment<TTp>                       value_type;
+    typedef mmap_segment_iterator<TTp, TBufSize>    iterator;
+    typedef iterator                                const_iterator;
+
+    /// @param  buf_mapper - mapper of the container.
+    /// @param  first      - position of the first element of the range in the mapping.
+    /// @param  last       - position past the last element of the range in the mapping.
+    /// @param  delta      - distance from the start of the mapping to the first element
+    ///                      of the container.
+    mmap_segment_range(const _mapper& buf_mapper, size_t first, size_t last, size_t delta)
+        : m_begin(buf_mapper, first / TBufSize, first, last, delta)
+        , m_end(buf_mapper, (first < last) ? (last - 1) / TBufSize + 1 : first / TBufSize, first, last, delta)
+    {}
+
+    iterator begin() const { return m_begin; }
+
+    iterator end() const { return m_end; }
+
+private:
+    iterator m_begin;
+    iterator m_end;
+};
+
+} // namespace details
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_SEGMENTS_H */
@@ -0,0 +1,296 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_SIMD_H
+#define _MMAP_CONTAINERS_MFCNT_SIMD_H
+
+extern "C" {
+    #include <string.h>
+}
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "mfcnt/types.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define MFCNT_SIMD_X86
+    #include <immintrin.h>
+#endif
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+namespace simd {
+
+// Byte search kernels of the algorithms over the char containers. The kernels
+// run over the contiguous span of a window. The x86-64 kernels use SSE2, which
+// every x86-64 CPU has, or AVX2 if the CPU supports it, the choice is made once
+// on the first call. Other architectures use the scalar kernels.
+
+typedef size_t (*count_fn)(const char*, const char*, char);
+typedef const char* (*find_first_of_fn)(const char*, const char*, const char*, size_t);
+typedef const char* (*search_fn)(const char*, const char*, const char*, size_t);
+
+/// Maximum size of the set of find_first_of() compared by the vector instructions,
+/// larger sets are looked up in the table.
+constexpr size_t kMaxVectorSet = 16;
+
+/// @brief  Find the first byte equal to the value.
+/// @note   memchr() of the C library is vectorized and dispatched by the CPU already.
+inline const char* find(const char* first, const char* last, const char value)
+{
+    const void* p_found = ::memchr(first, value, last - first);
+    return p_found ? static_cast<const char*>(p_found) : last;
+}
+
+inline size_t count_scalar(const char* first, const char* last, const char value)
+{
+    size_t res = 0;
+    for (; first != last; ++first) {
+        res += (*first == value);
+    }
+    return res;
+}
+
+/// @brief  Find the first byte which is in the set by the table of the set.
+inline const char* find_first_of_scalar(const char* first, const char* last, const char* p_set, const size_t set_size)
+{
+    bool table[256] = {};
+    for (size_t i = 0; i < set_size; ++i) {
+        table[uint8_t(p_set[i])] = true;
+    }
+    for (; first != last; ++first) {
+        if (table[uint8_t(*first)]) {
+            return first;
+        }
+    }
+    return last;
+}
+
+inline const char* search_scalar(const char* first, const char* last, const char* p_needle, const size_t needle_size)
+{
+    if (needle_size == 0) {
+        return first;
+    }
+    for (; size_t(last - first) >= needle_size; ++first) {
+        first = find(first, last - needle_size + 1, p_needle[0]);
+        if (size_t(last - first) < needle_size) {
+            break;
+        }
+        if (::memcmp(first + 1, p_needle + 1, needle_size - 1) == 0) {
+            return first;
+        }
+    }
+    return last;
+}
+
+#ifdef MFCNT_SIMD_X86
+
+inline size_t count_sse2(const char* first, const char* last, const char value)
+{
+    const __m128i needle = _mm_set1_epi8(value);
+    const __m128i zero = _mm_setzero_si128();
+    size_t res = 0;
+    while (last - first >= 16) {
+        // Byte counters of the lanes overflow after 255 blocks.
+        const char* block_last = first + std::min<size_t>((last - first) / 16, 255) * 16;
+        __m128i acc = zero;
+        for (; first != block_last; first += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(block, needle));
+        }
+        const __m128i sums = _mm_sad_epu8(acc, zero);
+        res += size_t(_mm_cvtsi128_si64(sums)) + size_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+    }
+    return res + count_scalar(first, last, value);
+}
+
+__attribute__((target("avx2")))
+inline size_t count_avx2(const char* first, const char* last, const char value)
+{
+    const __m256i needle = _mm256_set1_epi8(value);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t res = 0;
+    while (last - first >= 32) {
+        const char* block_last = first + std::min<size_t>((last - first) / 32, 255) * 32;
+        __m256i acc = zero;
+        for (; first != block_last; first += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(block, needle));
+        }
+        const __m256i sums = _mm256_sad_epu8(acc, zero);
+        res += size_t(_mm256_extract_epi64(sums, 0)) + size_t(_mm256_extract_epi64(sums, 1))
+               + size_t(_mm256_extract_epi64(sums, 2)) + size_t(_mm256_extract_epi64(sums, 3));
+    }
+    return res + count_scalar(first, last, value);
+}
+
+inline const char* find_first_of_sse2(const char* first, const char* last, const char* p_set, const size_t set_size)
+{
+    if (set_size > kMaxVectorSet) {
+        return find_first_of_scalar(first, last, p_set, set_size);
+    }
+
+    __m128i needles[kMaxVectorSet];
+    for (size_t i = 0; i < set_size; ++i) {
+        needles[i] = _mm_set1_epi8(p_set[i]);
+    }
+    for (; last - first >= 16; first += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        __m128i eq = _mm_setzero_si128();
+        for (size_t i = 0; i < set_size; ++i) {
+            eq = _mm_or_si128(eq, _mm_cmpeq_epi8(block, needles[i]));
+        }
+        const unsigned mask = unsigned(_mm_movemask_epi8(eq));
+        if (mask) {
+            return first + __builtin_ctz(mask);
+        }
+    }
+    return find_first_of_scalar(first, last, p_set, set_size);
+}
+
+__attribute__((target("avx2")))
+inline const char* find_first_of_avx2(const char* first, const char* last, const char* p_set, const size_t set_size)
+{
+    if (set_size > kMaxVectorSet) {
+        return find_first_of_scalar(first, last, p_set, set_size);
+    }
+
+    __m256i needles[kMaxVectorSet];
+    for (size_t i = 0; i < set_size; ++i) {
+        needles[i] = _mm256_set1_epi8(p_set[i]);
+    }
+    for (; last - first >= 32; first += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        __m256i eq = _mm256_setzero_si256();
+        for (size_t i = 0; i < set_size; ++i) {
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(block, needles[i]));
+        }
+        const unsigned mask = unsigned(_mm256_movemask_epi8(eq));
+        if (mask) {
+            return first + __builtin_ctz(mask);
+        }
+    }
+    return find_first_of_scalar(first, last, p_set, set_size);
+}
+
+/// @brief  Find the substring by the first and the last bytes of the needle,
+///         the candidates are compared by memcmp().
+inline const char* search_sse2(const char* first, const char* last, const char* p_needle, const size_t needle_size)
+{
+    if (needle_size < 2) {
+        return (needle_size == 0) ? first : find(first, last, p_needle[0]);
+    }
+
+    const __m128i head = _mm_set1_epi8(p_needle[0]);
+    const __m128i tail = _mm_set1_epi8(p_needle[needle_size - 1]);
+    for (; size_t(last - first) >= needle_size - 1 + 16; first += 16) {
+        const __m128i block_head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const __m128i block_tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + needle_size - 1));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_head, head),
+                                                                 _mm_cmpeq_epi8(block_tail, tail))));
+        for (; mask; mask &= mask - 1) {
+            const char* p_candidate = first + __builtin_ctz(mask);
+            if (::memcmp(p_candidate + 1, p_needle + 1, needle_size - 2) == 0) {
+                return p_candidate;
+            }
+        }
+    }
+    return search_scalar(first, last, p_needle, needle_size);
+}
+
+__attribute__((target("avx2")))
+inline const char* search_avx2(const char* first, const char* last, const char* p_needle, const size_t needle_size)
+{
+    if (needle_size < 2) {
+        return (needle_size == 0) ? first : find(first, last, p_needle[0]);
+    }
+
+    const __m256i head = _mm256_set1_epi8(p_needle[0]);
+    const __m256i tail = _mm256_set1_epi8(p_needle[needle_size - 1]);
+    for (; size_t(last - first) >= needle_size - 1 + 32; first += 32) {
+        const __m256i block_head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const __m256i block_tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + needle_size - 1));
+        unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_head, head),
+                                                                       _mm256_cmpeq_epi8(block_tail, tail))));
+        for (; mask; mask &= mask - 1) {
+            const char* p_candidate = first + __builtin_ctz(mask);
+            if (::memcmp(p_candidate + 1, p_needle + 1, needle_size - 2) == 0) {
+                return p_candidate;
+            }
+        }
+    }
+    return search_scalar(first, last, p_needle, needle_size);
+}
+
+inline bool has_avx2()
+{
+    static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+    return avx2;
+}
+
+#else
+
+inline bool has_avx2() { return false; }
+
+#endif
+
+inline size_t count(const char* first, const char* last, const char value)
+{
+#ifdef MFCNT_SIMD_X86
+    static const count_fn p_kernel = has_avx2() ? count_avx2 : count_sse2;
+#else
+    static const count_fn p_kernel = count_scalar;
+#endif
+    return p_kernel(first, last, value);
+}
+
+inline const char* find_first_of(const char* first, const char* last, const char* p_set, const size_t set_size)
+{
+#ifdef MFCNT_SIMD_X86
+    static const find_first_of_fn p_kernel = has_avx2() ? find_first_of_avx2 : find_first_of_sse2;
+#else
+    static const find_first_of_fn p_kernel = find_first_of_scalar;
+#endif
+    return p_kernel(first, last, p_set, set_size);
+}
+
+inline const char* search(const char* first, const char* last, const char* p_needle, const size_t needle_size)
+{
+#ifdef MFCNT_SIMD_X86
+    static const search_fn p_kernel = has_avx2() ? search_avx2 : search_sse2;
+#else
+    static const search_fn p_kernel = search_scalar;
+#endif
+    return p_kernel(first, last, p_needle, needle_size);
+}
+
+} // namespace simd
+} // namespace details
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_SIMD_H */
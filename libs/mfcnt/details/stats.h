@@ -0,0 +1,201 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_STATS_H
+#define _MMAP_CONTAINERS_MFCNT_STATS_H
+
+#ifdef MFCNT_STATS
+extern "C" {
+    #include <sys/resource.h>
+}
+
+#include <atomic>
+#include <chrono>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mfcnt/types.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+namespace utils {
+
+#ifdef MFCNT_STATS
+
+/// @brief  Counters of the mapping activity of the buffer.
+/// @details    The counters are relaxed atomics, so the buffer can be used by
+///             several threads. Page faults are counted for the whole process
+///             by the deltas of getrusage() since the counters were reset.
+class stats_counters
+{
+public:
+    /// @brief  Add the time till the end of the scope to the time of the system calls.
+    class syscall_timer
+    {
+    public:
+        explicit syscall_timer(const stats_counters& counters)
+            : m_counters(counters)
+            , m_start(std::chrono::steady_clock::now())
+        {}
+
+        ~syscall_timer()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_counters.m_syscall_nsecs.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+        }
+
+        syscall_timer(const syscall_timer&) = delete;
+        syscall_timer& operator=(const syscall_timer&) = delete;
+
+    private:
+        const stats_counters& m_counters;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    stats_counters() { reset(); }
+
+    stats_counters(const stats_counters& orig) { assign(orig); }
+
+    stats_counters& operator=(const stats_counters& orig)
+    {
+        assign(orig);
+        return *this;
+    }
+
+    void on_remap(const size_t length) const
+    {
+        m_remaps.fetch_add(1, std::memory_order_relaxed);
+        m_mapped_bytes.fetch_add(length, std::memory_order_relaxed);
+    }
+
+    void on_unmap() const { m_unmaps.fetch_add(1, std::memory_order_relaxed); }
+    void on_hit() const { m_hits.fetch_add(1, std::memory_order_relaxed); }
+    void on_miss() const { m_misses.fetch_add(1, std::memory_order_relaxed); }
+    void on_buf_change() const { m_buf_changes.fetch_add(1, std::memory_order_relaxed); }
+
+    mfcnt::stats get() const
+    {
+        mfcnt::stats st;
+        st.remaps = m_remaps.load(std::memory_order_relaxed);
+        st.unmaps = m_unmaps.load(std::memory_order_relaxed);
+        st.mapped_bytes = m_mapped_bytes.load(std::memory_order_relaxed);
+        st.hits = m_hits.load(std::memory_order_relaxed);
+        st.misses = m_misses.load(std::memory_order_relaxed);
+        st.buf_changes = m_buf_changes.load(std::memory_order_relaxed);
+        st.syscall_nsecs = m_syscall_nsecs.load(std::memory_order_relaxed);
+
+        struct ::rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        st.minor_faults = usage.ru_minflt - m_minor_faults;
+        st.major_faults = usage.ru_majflt - m_major_faults;
+        return st;
+    }
+
+    void reset()
+    {
+        m_remaps.store(0, std::memory_order_relaxed);
+        m_unmaps.store(0, std::memory_order_relaxed);
+        m_mapped_bytes.store(0, std::memory_order_relaxed);
+        m_hits.store(0, std::memory_order_relaxed);
+        m_misses.store(0, std::memory_order_relaxed);
+        m_buf_changes.store(0, std::memory_order_relaxed);
+        m_syscall_nsecs.store(0, std::memory_order_relaxed);
+
+        struct ::rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        m_minor_faults = usage.ru_minflt;
+        m_major_faults = usage.ru_majflt;
+    }
+
+    void swap(stats_counters& orig)
+    {
+        stats_counters tmp(orig);
+        orig.assign(*this);
+        assign(tmp);
+    }
+
+private:
+    void assign(const stats_counters& orig)
+    {
+        m_remaps.store(orig.m_remaps.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_unmaps.store(orig.m_unmaps.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_mapped_bytes.store(orig.m_mapped_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_hits.store(orig.m_hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_misses.store(orig.m_misses.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_buf_changes.store(orig.m_buf_changes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_syscall_nsecs.store(orig.m_syscall_nsecs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_minor_faults = orig.m_minor_faults;
+        m_major_faults = orig.m_major_faults;
+    }
+
+    mutable std::atomic<size_t> m_remaps;
+    mutable std::atomic<size_t> m_unmaps;
+    mutable std::atomic<size_t> m_mapped_bytes;
+    mutable std::atomic<size_t> m_hits;
+    mutable std::atomic<size_t> m_misses;
+    mutable std::atomic<size_t> m_buf_changes;
+    mutable std::atomic<uint64_t> m_syscall_nsecs;
+
+    /// Page faults of the process when the counters were reset.
+    size_t m_minor_faults;
+    size_t m_major_faults;
+};
+
+#else
+
+/// @brief  Counters of the mapping activity of the buffer, compiled out
+///         without MFCNT_STATS: the class has no data and the calls are empty.
+class stats_counters
+{
+public:
+    class syscall_timer
+    {
+    public:
+        explicit syscall_timer(const stats_counters&) {}
+    };
+
+    void on_remap(size_t) const {}
+    void on_unmap() const {}
+    void on_hit() const {}
+    void on_miss() const {}
+    void on_buf_change() const {}
+
+    mfcnt::stats get() const { return mfcnt::stats(); }
+
+    void reset() {}
+    void swap(stats_counters&) {}
+};
+
+#endif
+
+} // namespace utils
+} // namespace details
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_STATS_H */
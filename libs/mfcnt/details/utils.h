@@ -27,21 +27,33 @@
 
 extern "C" {
     #include <fcntl.h>
+    #include <linux/magic.h>
     #include <string.h>
     #include <sys/mman.h>
     #include <sys/stat.h>
+    #include <sys/statfs.h>
     #include <sys/types.h>
     #include <unistd.h>
 }
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "mfcnt/types.h"
+#include "mfcnt/details/stats.h"
 
 namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
 namespace details {
 namespace utils {
 
@@ -52,6 +64,7 @@ struct mmap_options
         , offset(0)
         , prot(-1)
         , flags(-1)
+        , pages(page_policy::BASE_PAGES)
     {}
 
     /// File descriptor.
@@ -68,45 +81,326 @@ struct mmap_options
     /// processes mapping the same region, and whether updates are carried
     /// through to the underlying file.
     int flags;
+
+    /// Size of the pages the mappings are aligned with.
+    page_policy pages;
+};
+
+/// @brief  Memory page size calculation.
+/// @return Memory page size.
+inline long memory_page_size()
+{
+    return ::sysconf(_SC_PAGE_SIZE);
+}
+
+/// @brief  Convert the access pattern hint to the madvise advice.
+inline int madvise_advice(const advice a)
+{
+    switch (a) {
+    case advice::SEQUENTIAL:    return MADV_SEQUENTIAL;
+    case advice::RANDOM:        return MADV_RANDOM;
+    case advice::WILLNEED:      return MADV_WILLNEED;
+    case advice::DONTNEED:      return MADV_DONTNEED;
+    default:                    return MADV_NORMAL;
+    }
+}
+
+/// @brief  Convert the access pattern hint to the posix_fadvise advice.
+inline int fadvise_advice(const advice a)
+{
+    switch (a) {
+    case advice::SEQUENTIAL:    return POSIX_FADV_SEQUENTIAL;
+    case advice::RANDOM:        return POSIX_FADV_RANDOM;
+    case advice::WILLNEED:      return POSIX_FADV_WILLNEED;
+    case advice::DONTNEED:      return POSIX_FADV_DONTNEED;
+    default:                    return POSIX_FADV_NORMAL;
+    }
+}
+
+/// @brief  Apply the access pattern hint to the mapping.
+/// @note   The hint is advisory, so the result is not checked.
+inline void madvise_buf(void* p_addr, const size_t length, const advice a)
+{
+    ::madvise(p_addr, length, madvise_advice(a));
+}
+
+/// @brief  Default number of windows kept mapped by the mmap_buffer.
+const size_t kDefaultWindowCount = 4;
+
+/// @brief  The smallest memory page size the windows are checked against
+///         at compile time.
+const size_t kMinPageSize = 4096;
+
+/// @brief  Size of the transparent huge page.
+const size_t kHugePageSize = 1 << 21;
+
+/// @brief  Desired size of the mapping kept by the table of windows, so that
+///         small windows do not exhaust the limit of mappings of the process.
+const size_t kChunkSize = kHugePageSize;
+
+/// @brief  Number of chunks of the segmented container kept mapped at once,
+///         the chunk mapped first is unmapped first.
+const size_t kLiveChunkCount = 64;
+
+/// @brief  Largest number of chunks the concurrent container maps one by one.
+/// @details    The chunks of the concurrent container are never unmapped, so
+///             a larger range is mapped whole to stay well below the default
+///             limit of mappings of the process (vm.max_map_count is 65530).
+const size_t kMaxConcurrentChunkCount = 16384;
+
+/// @brief  Map the file at the address congruent to the offset modulo the alignment.
+/// @details    The kernel backs only the aligned parts of the mapping with huge
+///             pages, so the address space is reserved with the margin for the
+///             alignment and the file is mapped over the aligned part of it.
+/// @param  align - alignment, power of two multiple of the memory page size.
+/// @return Pointer to the mapping or MAP_FAILED with errno set.
+inline void* mmap_aligned(const size_t length, const int prot, const int flags,
+                          const int fd, const off64_t offset, const size_t align)
+{
+    char* p_area = (char*)::mmap64(nullptr, length + align, PROT_NONE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p_area == MAP_FAILED) {
+        return MAP_FAILED;
+    }
+
+    const size_t shift = (size_t(offset) - size_t(p_area)) & (align - 1);
+    void* p_addr = ::mmap64(p_area + shift, length, prot, flags | MAP_FIXED, fd, offset);
+    if (p_addr == MAP_FAILED) {
+        const int err = errno;
+        ::munmap(p_area, length + align);
+        errno = err;
+        return MAP_FAILED;
+    }
+
+    // Release the margins of the reserved address space.
+    const size_t page_size = memory_page_size();
+    const size_t map_length = (length + page_size - 1) / page_size * page_size;
+    if (shift != 0) {
+        ::munmap(p_area, shift);
+    }
+    if (shift != align) {
+        ::munmap(p_area + shift + map_length, align - shift);
+    }
+    return p_addr;
+}
+
+/// @brief  Round up to the nearest power of two.
+constexpr size_t ceil_pow2(size_t val, size_t res = 1)
+{
+    return (res >= val) ? res : ceil_pow2(val, res << 1);
+}
+
+/// @brief  Integer binary logarithm.
+constexpr size_t ilog2(size_t val)
+{
+    return (val <= 1) ? 0 : 1 + ilog2(val >> 1);
+}
+
+/// @brief  Compile-time geometry of the window of the file.
+/// @tparam TTp    - type of the element.
+/// @tparam TCount - desired number of elements in the window. The number is
+///                  rounded up to a power of two, so that the position of the element
+///                  is split into the window number and the offset in the window by
+///                  shift and mask instead of division.
+template<typename TTp, size_t TCount>
+struct window_geometry
+{
+    static_assert(TCount > 0, "window_geometry: window must contain at least one element");
+    static_assert(TCount <= (SIZE_MAX >> 1) / sizeof(TTp), "window_geometry: window size overflows size_t");
+
+    static constexpr size_t count = ceil_pow2(TCount);
+    static constexpr size_t shift = ilog2(count);
+    static constexpr size_t mask = count - 1;
+    static constexpr size_t bytes = count * sizeof(TTp);
+
+    static_assert(! (bytes % kMinPageSize),
+                  "window_geometry: window of TCount elements can not be aligned with the memory page, increase TCount");
 };
 
+/// @tparam TPtr     - pointer to the element.
+/// @tparam TBufSize - number of elements in the window, power of two.
 template<typename TPtr, size_t TBufSize>
 struct mmap_buffer
 {
-    typedef TPtr    pointer;
+    typedef TPtr                                        pointer;
+    typedef typename std::remove_pointer<TPtr>::type    value_type;
+
+    static_assert(! (TBufSize & (TBufSize - 1)), "mmap_buffer: number of elements in the window must be a power of two");
+
+    /// Size of the window in bytes.
+    static constexpr size_t buf_bytes = TBufSize * sizeof(value_type);
+
+    /// Number of windows mapped at once by the table of windows, power of two.
+    static constexpr size_t chunk_windows = size_t(1) << ilog2(kChunkSize / buf_bytes);
+    static constexpr size_t chunk_bytes = chunk_windows * buf_bytes;
+
+    /// @brief  Mapped "segment" of the file.
+    struct window
+    {
+        window()
+            : p_buf(nullptr)
+            , buf_num(0)
+            , last_use(0)
+        {}
+
+        /// Pointer to mapping in memory or nullptr if the window is free.
+        pointer p_buf;
+
+        /// The number of the "segment" of the file.
+        size_t buf_num;
+
+        /// Value of the use counter at the last access to the window.
+        size_t last_use;
+    };
 
     mmap_buffer()
         : open_flags(-1)
-        , p_cur_buf(nullptr)
-        , cur_buf_num(0)
+        , windows(kDefaultWindowCount)
+        , mru_idx(0)
+        , use_tick(0)
+        , p_whole(nullptr)
+        , whole_size(0)
+        , chunk_count(0)
+        , live_pos(0)
+        , concurrent(false)
+        , page_bytes(memory_page_size())
+        , adv(advice::NORMAL)
+        , prefetch_pos(0)
     {}
 
     mmap_buffer(const std::string& path, const mode m)
         : open_flags(-1)
-        , p_cur_buf(nullptr)
-        , cur_buf_num(0)
+        , windows(kDefaultWindowCount)
+        , mru_idx(0)
+        , use_tick(0)
+        , p_whole(nullptr)
+        , whole_size(0)
+        , chunk_count(0)
+        , live_pos(0)
+        , concurrent(false)
+        , page_bytes(memory_page_size())
+        , adv(advice::NORMAL)
+        , prefetch_pos(0)
     {
         open(path, m);
     }
 
     mmap_buffer(const mmap_buffer& orig)
         : open_flags(-1)
-        , p_cur_buf(nullptr)
+        , windows(orig.windows.size())
+        , mru_idx(0)
+        , use_tick(0)
+        , p_whole(nullptr)
+        , whole_size(0)
+        , chunk_count(0)
+        , live_pos(0)
+        , concurrent(false)
+        , page_bytes(memory_page_size())
+        , adv(advice::NORMAL)
+        , prefetch_pos(orig.prefetch_pos)
     {
         opts.offset = orig.opts.offset;
+        opts.pages = orig.opts.pages;
         open(orig.file_path, orig.open_flags, orig.opts.prot, orig.opts.flags);
-        map(orig.cur_buf_num);
+        if (orig.p_whole) {
+            map_whole(orig.whole_size);
+        }
+        if (orig.p_chunks) {
+            map_chunks(orig.chunk_count * chunk_bytes - buf_bytes);
+        }
+        concurrent = orig.concurrent;
+        if (orig.adv != advice::NORMAL) {
+            advise(orig.adv);
+        }
     }
 
     mmap_buffer(mmap_buffer&& orig)
         : opts(std::move(orig.opts))
         , file_path(std::move(orig.file_path))
         , open_flags(std::move(orig.open_flags))
-        , p_cur_buf(std::move(orig.p_cur_buf))
-        , cur_buf_num(std::move(orig.cur_buf_num))
+        , windows(std::move(orig.windows))
+        , mru_idx(orig.mru_idx)
+        , use_tick(orig.use_tick)
+        , p_whole(orig.p_whole)
+        , whole_size(orig.whole_size)
+        , p_chunks(std::move(orig.p_chunks))
+        , chunk_count(orig.chunk_count)
+        , p_gens(std::move(orig.p_gens))
+        , p_locked(std::move(orig.p_locked))
+        , live_chunks(std::move(orig.live_chunks))
+        , live_pos(orig.live_pos)
+        , concurrent(orig.concurrent)
+        , page_bytes(orig.page_bytes)
+        , adv(orig.adv)
+        , prefetch_pos(orig.prefetch_pos)
+        , counters(orig.counters)
     {
         orig.opts.fd = -1;
-        orig.p_cur_buf = nullptr;
+        orig.windows.clear();
+        orig.mru_idx = 0;
+        orig.p_whole = nullptr;
+        orig.whole_size = 0;
+        orig.chunk_count = 0;
+        orig.live_pos = 0;
+    }
+
+    /// @brief  Set the access pattern hint for the file.
+    /// @details    The hint is passed to the kernel for the file descriptor and
+    ///             for the mapped windows, and is applied to each new window.
+    /// @param  a - access pattern hint.
+    void advise(const advice a)
+    {
+        assert(is_open());
+
+        adv = a;
+        // Zero length means the hint is applied up to the end of the file.
+        ::posix_fadvise(opts.fd, opts.offset, 0, fadvise_advice(adv));
+
+        if (p_whole) {
+            madvise_buf(p_whole, whole_size, adv);
+        }
+        for (const window& w : windows) {
+            if (w.p_buf) {
+                madvise_buf(w.p_buf, buf_bytes, adv);
+            }
+        }
+        for (size_t i = 0; i < chunk_count; ++i) {
+            pointer p_buf = p_chunks[i].load(std::memory_order_acquire);
+            if (p_buf) {
+                madvise_buf(p_buf, chunk_bytes, adv);
+            }
+        }
+    }
+
+    /// @brief  Set the access pattern hint for the range of the file.
+    /// @details    Unlike advise(a) the hint is not applied to new windows.
+    /// @param  a     - access pattern hint.
+    /// @param  first - offset of the range from opts.offset in bytes.
+    /// @param  last  - offset past the end of the range from opts.offset in bytes.
+    void advise(const advice a, const size_t first, const size_t last) const
+    {
+        assert(is_open());
+        assert(first <= last);
+
+        if (first == last) {
+            return;
+        }
+        ::posix_fadvise(opts.fd, opts.offset + first, last - first, fadvise_advice(a));
+
+        if (p_whole) {
+            madvise_range(p_whole, 0, whole_size, first, last, a);
+        }
+        for (const window& w : windows) {
+            if (w.p_buf) {
+                madvise_range(w.p_buf, w.buf_num * buf_bytes, buf_bytes, first, last, a);
+            }
+        }
+        for (size_t i = first / chunk_bytes; i < chunk_count && i * chunk_bytes < last; ++i) {
+            pointer p_buf = p_chunks[i].load(std::memory_order_acquire);
+            if (p_buf) {
+                madvise_range(p_buf, i * chunk_bytes, chunk_bytes, first, last, a);
+            }
+        }
     }
 
     /// @brief  Unmap buffer and close the file.
@@ -136,36 +430,299 @@ struct mmap_buffer
         return st.st_size;
     }
 
+    /// @brief  Read the pages of the range into memory, so the following
+    ///         accesses do not wait for the disk.
+    /// @details    The pages are kept by the whole mapping or by the table of
+    ///             chunks, windows of the cache are mapped from the page cache
+    ///             without reading the file. The segmented buffer loads the
+    ///             pages through the temporary mappings, unless the pages are
+    ///             locked: the locked chunks are kept in the table until the
+    ///             buffer is closed and never unmapped to make room for others.
+    /// @param  length       - the length of the range starting at opts.offset.
+    /// @param  policy       - how the pages are read.
+    /// @param  thread_count - number of threads of load_policy::PREFAULT,
+    ///                        0 is the number of the hardware threads.
+    /// @param  lock         - lock the pages in memory with mlock.
+    /// @throw  std::runtime_error if can not map or lock the pages.
+    void eager_load(const size_t length, const load_policy policy, size_t thread_count, const bool lock) const
+    {
+        assert(is_open());
+
+        if (length == 0) {
+            return;
+        }
+
+        // Locked pages stay locked only while they are mapped.
+        const bool keep = lock || p_whole || concurrent;
+        if (lock && ! p_whole && ! concurrent) {
+            lock_chunks(length);
+        }
+        if (policy == load_policy::POPULATE) {
+            populate(length, keep);
+        } else {
+            thread_count = (thread_count != 0) ? thread_count : std::thread::hardware_concurrency();
+            prefault(length, (thread_count != 0) ? thread_count : 1, keep);
+        }
+
+        if (lock) {
+            for (size_t first = 0; first < length; first += region_bytes()) {
+                const size_t last = std::min(first + region_bytes(), length);
+                if (::mlock(region(first), last - first) == -1) {
+                    throw std::runtime_error("eager_load: error lock pages: " + str_error_r(errno));
+                }
+            }
+        }
+    }
+
+    /// @brief  Write the modified pages of the range to the file.
+    /// @param  first - offset of the range from opts.offset in bytes.
+    /// @param  last  - offset past the end of the range from opts.offset in bytes.
+    /// @param  async - start the writeback and return without waiting for it.
+    /// @throw  std::runtime_error if can not write the pages.
+    void flush(const size_t first, const size_t last, const bool async) const
+    {
+        assert(is_open());
+        assert(first <= last);
+
+        if (first == last) {
+            return;
+        }
+
+        const int flags = async ? MS_ASYNC : MS_SYNC;
+        if (p_whole) {
+            msync_range(p_whole, 0, whole_size, first, last, flags);
+        }
+        for (const window& w : windows) {
+            if (w.p_buf) {
+                msync_range(w.p_buf, w.buf_num * buf_bytes, buf_bytes, first, last, flags);
+            }
+        }
+        for (size_t i = first / chunk_bytes; i < chunk_count && i * chunk_bytes < last; ++i) {
+            pointer p_buf = p_chunks[i].load(std::memory_order_acquire);
+            if (p_buf) {
+                msync_range(p_buf, i * chunk_bytes, chunk_bytes, first, last, flags);
+            }
+        }
+
+        // MS_ASYNC only marks the pages for the writeback, so the writeback is started explicitly.
+        if (async && ::sync_file_range(opts.fd, opts.offset + first, last - first, SYNC_FILE_RANGE_WRITE) == -1) {
+            throw std::runtime_error("flush: error start writeback: " + str_error_r(errno));
+        }
+    }
+
     bool is_open() const { return (opts.fd != -1); }
 
     /// @brief  Mapping file to buffer.
     /// @param  buf_num - the number of the "segment" of the file to be mapping in memory.
     /// @return Pointer to mapping in memory.
+    /// @note   The pointer remains valid until the window is evicted by
+    ///         the following window_count() misses.
     pointer map(const size_t buf_num) const
     {
         assert(is_open());
+        assert(! windows.empty());
 
-        if (buf_num == cur_buf_num && p_cur_buf) {
-            return p_cur_buf;
+        const window& mru = windows[mru_idx];
+        if (mru.buf_num == buf_num && mru.p_buf) {
+            counters.on_hit();
+            return mru.p_buf;
         }
+        return map_window(buf_num);
+    }
 
-        p_cur_buf = (pointer)::mmap64(p_cur_buf, TBufSize, opts.prot, opts.flags,
-                                      opts.fd, opts.offset + buf_num * TBufSize);
-        if (p_cur_buf == MAP_FAILED) {
-            throw std::runtime_error("map: error map file to memory: " + str_error_r(errno));
+    /// @brief  Mapping the "segment" of the file from the table of chunks.
+    /// @details    Windows are mapped by chunks on the first access and published
+    ///             in the table with an atomic compare-and-swap, so the function
+    ///             can be called concurrently without locks. Chunks of the
+    ///             concurrent buffer stay mapped until the buffer is closed,
+    ///             the segmented buffer keeps kLiveChunkCount chunks mapped and
+    ///             changes the generation of the chunk it unmaps, see chunk_gen().
+    /// @param  buf_num - the number of the "segment" of the file.
+    /// @return Pointer to the window.
+    /// @throw  std::runtime_error if can not map file.
+    pointer map_persistent(const size_t buf_num) const
+    {
+        assert(is_open());
+
+        if (p_whole) {
+            counters.on_hit();
+            return p_whole + buf_num * TBufSize;
+        }
+
+        const size_t chunk_num = buf_num / chunk_windows;
+        assert(chunk_num < chunk_count);
+
+        pointer p_chunk = p_chunks[chunk_num].load(std::memory_order_acquire);
+        if (p_chunk) {
+            counters.on_hit();
+        } else {
+            counters.on_miss();
+            p_chunk = map_chunk(chunk_num);
+            if (! concurrent) {
+                live_chunk(chunk_num);
+            }
+        }
+        return p_chunk + (buf_num % chunk_windows) * TBufSize;
+    }
+
+    /// @brief  Generation of the chunk of the window in the table.
+    /// @details    The generation changes when the segmented buffer unmaps the
+    ///             chunk, so the holder of a pointer to the window compares the
+    ///             generations to learn whether the pointer is still valid.
+    /// @param  buf_num - the number of the "segment" of the file.
+    /// @return Pointer to the generation, it does not change for the whole
+    ///         mapping and the chunks of the concurrent buffer.
+    const size_t* chunk_gen(const size_t buf_num) const
+    {
+        static const size_t s_stable_gen = 0;
+
+        if (p_whole || ! p_gens) {
+            return &s_stable_gen;
+        }
+        assert(buf_num / chunk_windows < chunk_count);
+        return &p_gens[buf_num / chunk_windows];
+    }
+
+    /// @brief  Create the table of windows.
+    /// @param  length - the length of the range starting at opts.offset.
+    void map_chunks(const size_t length)
+    {
+        assert(is_open());
+
+        unmap_chunks();
+
+        // One extra window for the end iterator of the range that ends on the window bound.
+        chunk_count = ((length + buf_bytes - 1) / buf_bytes + chunk_windows) / chunk_windows;
+        p_chunks.reset(new std::atomic<pointer>[chunk_count]());
+        p_gens.reset(new size_t[chunk_count]());
+        p_locked.reset(new bool[chunk_count]());
+        live_chunks.assign(kLiveChunkCount, SIZE_MAX);
+        live_pos = 0;
+    }
+
+    /// @brief  Mapping the whole range of the file at once.
+    /// @param  length - the length of the range starting at opts.offset.
+    /// @return true if the range is mapped, false if the address space does
+    ///         not allow it, in which case the buffer keeps mapping by windows.
+    /// @throw  std::runtime_error if can not map file.
+    bool map_whole(const size_t length)
+    {
+        assert(is_open());
+        assert(length);
+
+        unmap();
+
+        // Mappings of hugetlbfs are unmapped only by whole huge pages.
+        const size_t map_length = (length + page_bytes - 1) / page_bytes * page_bytes;
+        pointer p_buf = map_range(map_length, opts.offset);
+        if (p_buf == MAP_FAILED) {
+            if (errno == ENOMEM) {
+                return false;
+            }
+            throw std::runtime_error("map_whole: error map file to memory: " + str_error_r(errno));
+        }
+
+        p_whole = p_buf;
+        whole_size = map_length;
+        if (adv != advice::NORMAL) {
+            madvise_buf(p_whole, whole_size, adv);
+        }
+        return true;
+    }
+
+    /// @brief  Change the length of the whole mapping.
+    /// @details    The mapping is extended in place if the address space allows
+    ///             it and moved otherwise, so pointers to the mapping are invalidated.
+    /// @param  length - the new length of the range starting at opts.offset,
+    ///                  zero unmaps the range.
+    /// @throw  std::runtime_error if can not map file.
+    void remap_whole(const size_t length)
+    {
+        assert(is_open());
+
+        if (length == 0) {
+            unmap();
+            return;
+        }
+        if (! p_whole) {
+            if (! map_whole(length)) {
+                throw std::runtime_error("remap_whole: error map file to memory: " + str_error_r(ENOMEM));
+            }
+            return;
+        }
+
+        pointer p_buf;
+        {
+            stats_counters::syscall_timer timer(counters);
+            p_buf = (pointer)::mremap(p_whole, whole_size, length, MREMAP_MAYMOVE);
+        }
+        if (p_buf == MAP_FAILED) {
+            throw std::runtime_error("remap_whole: error remap file to memory: " + str_error_r(errno));
+        }
+        counters.on_remap(length);
+
+        p_whole = p_buf;
+        whole_size = length;
+        if (adv != advice::NORMAL) {
+            madvise_buf(p_whole, whole_size, adv);
+        }
+    }
+
+    /// @brief  Change the size of the file.
+    /// @details    The blocks of the extended part of the file are allocated,
+    ///             so writes through the mapping do not fail with SIGBUS when
+    ///             the file system runs out of space.
+    /// @param  size - the new size of the file.
+    /// @throw  std::runtime_error if can not change the size of the file.
+    void resize_file(const size_t size)
+    {
+        assert(is_open());
+
+        const size_t cur_size = file_size();
+        if (size > cur_size) {
+            if (::fallocate64(opts.fd, 0, cur_size, size - cur_size) == 0) {
+                return;
+            }
+            if (errno != EOPNOTSUPP) {
+                throw std::runtime_error("resize_file: error allocate file: " + str_error_r(errno));
+            }
+            // The file system does not support the allocation, the file will be sparse.
+        }
+        if (::ftruncate64(opts.fd, size) == -1) {
+            throw std::runtime_error("resize_file: error truncate file: " + str_error_r(errno));
         }
-        cur_buf_num = buf_num;
-        return p_cur_buf;
     }
 
+    /// @brief  Ask the kernel to read the window ahead asynchronously.
+    /// @param  buf_num - the number of the "segment" of the file.
+    /// @note   The hint is advisory, so the result is not checked.
+    void prefetch(const size_t buf_num) const
+    {
+        assert(is_open());
+
+        ::posix_fadvise(opts.fd, opts.offset + buf_num * buf_bytes, buf_bytes, POSIX_FADV_WILLNEED);
+    }
+
+    /// @brief  Set the number of windows kept mapped at the same time.
+    /// @param  count - number of windows, must be greater than zero.
+    /// @note   All currently mapped windows are unmapped.
+    void set_window_count(const size_t count)
+    {
+        assert(count > 0);
+
+        unmap_windows();
+        windows.assign(count, window());
+    }
+
+    size_t window_count() const { return windows.size(); }
+
     /// @brief  Open the file.
     /// @param  path  - path to file.
     /// @param  m - open file mode.
     /// @throw  std::runtime_error if can not open file.
     void open(const std::string& path, const mode m)
     {
-        int open_fls = O_CLOEXEC | O_LARGEFILE;
-        open_fls = open_flags | (m == mode::R_ONLY) ? O_RDONLY : O_RDWR;
+        const int open_fls = O_CLOEXEC | O_LARGEFILE | ((m == mode::R_ONLY) ? O_RDONLY : O_RDWR);
 
         int prot_fls;
         int mmap_fls;
@@ -184,8 +741,11 @@ struct mmap_buffer
     }
 
     /// @brief  Open the file.
-    /// @param  path  - path to file.
-    /// @param  m - open file mode.
+    /// @param  path     - path to file.
+    /// @param  open_fls - flags with which the file is opened, the file
+    ///                    is created with 0644 permissions if O_CREAT is set.
+    /// @param  prot_fls - desired memory protection of the mapping.
+    /// @param  mmap_fls - flags of the mapping.
     /// @throw  std::runtime_error if can not open file.
     void open(const std::string& path, int open_fls, int prot_fls, int mmap_fls)
     {
@@ -195,10 +755,29 @@ struct mmap_buffer
         opts.prot = prot_fls;
         opts.flags = mmap_fls;
 
-        opts.fd = ::open(file_path.data(), open_flags);
+        opts.fd = ::open(file_path.data(), open_flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
         if (opts.fd == -1) {
             throw std::runtime_error("open: error open file: " + str_error_r(errno));
         }
+
+        // Files of hugetlbfs are mapped only by the huge pages of the file system.
+        struct ::statfs st;
+        page_bytes = memory_page_size();
+        if (::fstatfs(opts.fd, &st) == 0 && st.f_type == HUGETLBFS_MAGIC) {
+            page_bytes = st.f_bsize;
+        }
+    }
+
+    /// @brief  Write the data of the file and the metadata needed to read
+    ///         it, like the size of the file, to the storage.
+    /// @throw  std::runtime_error if can not synchronize the file.
+    void sync() const
+    {
+        assert(is_open());
+
+        if (::fdatasync(opts.fd) == -1) {
+            throw std::runtime_error("sync: error synchronize file: " + str_error_r(errno));
+        }
     }
 
     void swap(mmap_buffer& orig)
@@ -208,18 +787,69 @@ struct mmap_buffer
         std::swap(file_path, orig.file_path);
         std::swap(open_flags, orig.open_flags);
 
-        std::swap(p_cur_buf, orig.p_cur_buf);
-        std::swap(cur_buf_num, orig.cur_buf_num);
+        std::swap(windows, orig.windows);
+        std::swap(mru_idx, orig.mru_idx);
+        std::swap(use_tick, orig.use_tick);
+
+        std::swap(p_whole, orig.p_whole);
+        std::swap(whole_size, orig.whole_size);
+
+        std::swap(p_chunks, orig.p_chunks);
+        std::swap(chunk_count, orig.chunk_count);
+        std::swap(p_gens, orig.p_gens);
+        std::swap(p_locked, orig.p_locked);
+        std::swap(live_chunks, orig.live_chunks);
+        std::swap(live_pos, orig.live_pos);
+        std::swap(concurrent, orig.concurrent);
+        std::swap(page_bytes, orig.page_bytes);
+
+        std::swap(adv, orig.adv);
+        std::swap(prefetch_pos, orig.prefetch_pos);
+
+        counters.swap(orig.counters);
+    }
+
+    void unmap()
+    {
+        unmap_windows();
+
+        if (p_whole != nullptr) {
+            unmap_range(p_whole, whole_size);
+        }
+
+        p_whole = nullptr;
+        whole_size = 0;
+
+        unmap_chunks();
+        p_chunks.reset();
+        chunk_count = 0;
+        p_gens.reset();
+        p_locked.reset();
+        live_chunks.clear();
+        live_pos = 0;
+    }
+
+    void unmap_chunks()
+    {
+        for (size_t i = 0; i < chunk_count; ++i) {
+            pointer p_buf = p_chunks[i].exchange(nullptr, std::memory_order_acq_rel);
+            if (p_buf != nullptr) {
+                unmap_range(p_buf, chunk_bytes);
+            }
+        }
     }
 
-    void unmap() const
+    void unmap_windows() const
     {
-        if (p_cur_buf != nullptr) {
-            ::munmap(p_cur_buf, TBufSize);
+        for (window& w : windows) {
+            if (w.p_buf != nullptr) {
+                unmap_range(w.p_buf, buf_bytes);
+            }
+            w = window();
         }
 
-        p_cur_buf = nullptr;
-        cur_buf_num = 0;
+        mru_idx = 0;
+        use_tick = 0;
     }
 
     static std::string str_error_r(int error_code)
@@ -248,16 +878,320 @@ struct mmap_buffer
     std::string file_path;
     int open_flags;
 
-    mutable pointer p_cur_buf;
-    mutable size_t cur_buf_num;
+    mutable std::vector<window> windows;
+    mutable size_t mru_idx;
+    mutable size_t use_tick;
+
+    /// Mapping of the whole range or nullptr if the file is mapped by windows.
+    pointer p_whole;
+    size_t whole_size;
+
+    /// Table of chunks of windows of the iterators and the eager load.
+    std::unique_ptr<std::atomic<pointer>[]> p_chunks;
+    size_t chunk_count;
+
+    /// Generations of the chunks, see chunk_gen().
+    std::unique_ptr<size_t[]> p_gens;
+
+    /// Chunks locked by eager_load(), they are not unmapped until the buffer is closed.
+    std::unique_ptr<bool[]> p_locked;
+
+    /// Queue of the chunks mapped by the segmented buffer.
+    mutable std::vector<size_t> live_chunks;
+    mutable size_t live_pos;
+
+    /// map() takes windows from the table of chunks instead of the cache,
+    /// so the buffer can be read by several threads.
+    bool concurrent;
+
+    /// Size of the page of the file: the memory page size or the size of
+    /// the huge page if the file is on the hugetlbfs.
+    size_t page_bytes;
+
+    /// Access pattern hint applied to each new window.
+    advice adv;
+
+    /// Position in the window after which the sequential iteration reads
+    /// the next window ahead, 0 if the read-ahead is disabled.
+    size_t prefetch_pos;
+
+    /// Counters of the mapping activity, empty without MFCNT_STATS.
+    stats_counters counters;
+
+private:
+    /// @brief  Slow path of the map(): search the segment among all windows
+    ///         and, on a miss, replace the least recently used window.
+    pointer map_window(const size_t buf_num) const
+    {
+        if (p_whole) {
+            counters.on_hit();
+            return p_whole + buf_num * TBufSize;
+        }
+        if (concurrent) {
+            return map_persistent(buf_num);
+        }
+
+        ++use_tick;
+
+        size_t victim = 0;
+        for (size_t i = 0; i < windows.size(); ++i) {
+            window& w = windows[i];
+            if (w.p_buf && w.buf_num == buf_num) {
+                counters.on_hit();
+                w.last_use = use_tick;
+                mru_idx = i;
+                return w.p_buf;
+            }
+
+            const window& v = windows[victim];
+            if (v.p_buf && (! w.p_buf || w.last_use < v.last_use)) {
+                victim = i;
+            }
+        }
+
+        counters.on_miss();
+
+        window& w = windows[victim];
+        if (w.p_buf != nullptr) {
+            unmap_range(w.p_buf, buf_bytes);
+            w = window();
+        }
+
+        pointer p_buf = map_range(buf_bytes, opts.offset + buf_num * buf_bytes);
+        if (p_buf == MAP_FAILED) {
+            throw std::runtime_error("map: error map file to memory: " + str_error_r(errno));
+        }
+
+        if (adv != advice::NORMAL) {
+            madvise_buf(p_buf, buf_bytes, adv);
+        }
+
+        w.p_buf = p_buf;
+        w.buf_num = buf_num;
+        w.last_use = use_tick;
+        mru_idx = victim;
+        return p_buf;
+    }
+
+    /// @brief  Map the range again with MAP_POPULATE, the address of the mapping is kept.
+    /// @param  keep - map the persistent regions, otherwise the temporary mappings.
+    void populate(const size_t length, const bool keep) const
+    {
+        for (size_t first = 0; first < length; first += region_bytes()) {
+            const size_t map_length = region_bytes();
+            pointer p_buf = keep ? region(first) : nullptr;
+            void* p_addr;
+            {
+                stats_counters::syscall_timer timer(counters);
+                p_addr = ::mmap64(p_buf, map_length, opts.prot, opts.flags | (keep ? MAP_FIXED : 0) | MAP_POPULATE,
+                                  opts.fd, opts.offset + first);
+            }
+            if (p_addr == MAP_FAILED) {
+                throw std::runtime_error("eager_load: error map file to memory: " + str_error_r(errno));
+            }
+            counters.on_remap(map_length);
+            if (! keep) {
+                unmap_range((pointer)p_addr, map_length);
+                continue;
+            }
+            // The new mapping replaces the hints of the old one.
+            advise_pages(p_buf, map_length);
+            if (adv != advice::NORMAL) {
+                madvise_buf(p_buf, map_length, adv);
+            }
+        }
+    }
+
+    /// @brief  Touch the pages of the range from the pool of threads.
+    /// @param  keep - map the persistent regions, otherwise the temporary mappings.
+    void prefault(const size_t length, const size_t thread_count, const bool keep) const
+    {
+        // Ranges of the threads are aligned with the chunks, so a chunk is mapped by one thread.
+        const size_t per_thread = ((length + thread_count - 1) / thread_count + chunk_bytes - 1)
+                                  / chunk_bytes * chunk_bytes;
+
+        std::vector<std::exception_ptr> errors(thread_count);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count && t * per_thread < length; ++t) {
+            threads.emplace_back([this, &errors, t, keep, first = t * per_thread,
+                                  last = std::min((t + 1) * per_thread, length)]() {
+                try {
+                    for (size_t pos = first; pos < last;) {
+                        const size_t region_first = pos - pos % region_bytes();
+                        const size_t region_last = std::min(region_first + region_bytes(), last);
+                        pointer p_buf = keep ? region(region_first)
+                                             : map_range(region_bytes(), opts.offset + region_first);
+                        if (p_buf == MAP_FAILED) {
+                            throw std::runtime_error("eager_load: error map file to memory: " + str_error_r(errno));
+                        }
+                        const volatile char* p_region = (const char*)p_buf;
+                        for (; pos < region_last; pos += page_bytes) {
+                            (void)p_region[pos - region_first];
+                        }
+                        if (! keep) {
+                            unmap_range(p_buf, region_bytes());
+                        }
+                    }
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for (std::thread& th : threads) {
+            th.join();
+        }
+        for (const std::exception_ptr& p_error : errors) {
+            if (p_error) {
+                std::rethrow_exception(p_error);
+            }
+        }
+    }
+
+    /// @brief  Pointer to the persistent mapping of the region starting at the offset.
+    pointer region(const size_t offset) const
+    {
+        return p_whole ? (pointer)((char*)p_whole + offset) : map_persistent(offset / buf_bytes);
+    }
+
+    /// @brief  Size of the persistent mappings: the whole range or the chunk.
+    size_t region_bytes() const { return p_whole ? whole_size : chunk_bytes; }
+
+    /// @brief  Map the chunks of the range of the segmented buffer and keep
+    ///         them out of the queue, so the locked pages stay mapped.
+    void lock_chunks(const size_t length) const
+    {
+        for (size_t chunk_num = 0; chunk_num * chunk_bytes < length; ++chunk_num) {
+            if (p_chunks[chunk_num].load(std::memory_order_acquire) == nullptr) {
+                map_chunk(chunk_num);
+            }
+            p_locked[chunk_num] = true;
+        }
+    }
+
+    /// @brief  Map the range of the file, aligned with the huge page if it is requested.
+    /// @return Pointer to the mapping or MAP_FAILED with errno set.
+    pointer map_range(const size_t length, const size_t offset) const
+    {
+        pointer p_buf;
+        {
+            stats_counters::syscall_timer timer(counters);
+            if (opts.pages == page_policy::HUGE_PAGES) {
+                p_buf = (pointer)mmap_aligned(length, opts.prot, opts.flags, opts.fd, offset, huge_page_bytes());
+            } else {
+                p_buf = (pointer)::mmap64(nullptr, length, opts.prot, opts.flags, opts.fd, offset);
+            }
+        }
+        if (p_buf != MAP_FAILED) {
+            counters.on_remap(length);
+            advise_pages(p_buf, length);
+        }
+        return p_buf;
+    }
+
+    /// @brief  Alignment of the mappings with page_policy::HUGE_PAGES: the
+    ///         transparent huge page or the larger page of the hugetlbfs file.
+    size_t huge_page_bytes() const { return std::max(kHugePageSize, page_bytes); }
+
+    /// @brief  Ask the kernel to back the new mapping with transparent huge pages.
+    /// @note   The hint is advisory, so the result is not checked.
+    void advise_pages(pointer p_buf, const size_t length) const
+    {
+        if (opts.pages == page_policy::HUGE_PAGES) {
+            ::madvise(p_buf, length, MADV_HUGEPAGE);
+        }
+    }
+
+    /// @brief  Unmap the mapping of map_range().
+    void unmap_range(pointer p_buf, const size_t length) const
+    {
+        stats_counters::syscall_timer timer(counters);
+        ::munmap(p_buf, length);
+        counters.on_unmap();
+    }
+
+    /// @brief  Queue the chunk mapped by the segmented buffer and unmap the
+    ///         chunk mapped kLiveChunkCount chunks ago unless it is locked.
+    void live_chunk(const size_t chunk_num) const
+    {
+        size_t& slot = live_chunks[live_pos];
+        live_pos = (live_pos + 1) % live_chunks.size();
+
+        const size_t victim = slot;
+        slot = chunk_num;
+        if (victim == SIZE_MAX || victim == chunk_num || p_locked[victim]) {
+            return;
+        }
+
+        pointer p_buf = p_chunks[victim].exchange(nullptr, std::memory_order_acq_rel);
+        if (p_buf != nullptr) {
+            unmap_range(p_buf, chunk_bytes);
+            ++p_gens[victim];
+        }
+    }
+
+    /// @brief  Slow path of the map_persistent(): map the chunk and publish it in the table.
+    pointer map_chunk(const size_t chunk_num) const
+    {
+        pointer p_buf = map_range(chunk_bytes, opts.offset + chunk_num * chunk_bytes);
+        if (p_buf == MAP_FAILED) {
+            throw std::runtime_error("map: error map file to memory: " + str_error_r(errno));
+        }
+        if (adv != advice::NORMAL) {
+            madvise_buf(p_buf, chunk_bytes, adv);
+        }
+
+        pointer p_expected = nullptr;
+        if (! p_chunks[chunk_num].compare_exchange_strong(p_expected, p_buf, std::memory_order_acq_rel,
+                                                          std::memory_order_acquire)) {
+            // Another thread has published the chunk first.
+            unmap_range(p_buf, chunk_bytes);
+            p_buf = p_expected;
+        }
+        return p_buf;
+    }
+
+    /// @brief  Apply the hint to the intersection of the mapping and the range.
+    /// @param  p_buf     - pointer to the mapping.
+    /// @param  buf_first - offset of the mapping from opts.offset in bytes.
+    /// @param  length    - length of the mapping in bytes.
+    /// @param  first     - offset of the range from opts.offset in bytes.
+    /// @param  last      - offset past the end of the range from opts.offset in bytes.
+    /// @param  a         - access pattern hint.
+    static void madvise_range(pointer p_buf, size_t buf_first, size_t length,
+                              size_t first, size_t last, advice a)
+    {
+        const size_t page_size = memory_page_size();
+        // The mapping is aligned with the memory page, so is the intersection.
+        first -= first % page_size;
+        first = (first > buf_first) ? first : buf_first;
+        last = (last < buf_first + length) ? last : buf_first + length;
+        if (first < last) {
+            madvise_buf((char*)p_buf + (first - buf_first), last - first, a);
+        }
+    }
+
+    /// @brief  Write the modified pages of the intersection of the mapping and the range.
+    /// @param  p_buf     - pointer to the mapping.
+    /// @param  buf_first - offset of the mapping from opts.offset in bytes.
+    /// @param  length    - length of the mapping in bytes.
+    /// @param  first     - offset of the range from opts.offset in bytes.
+    /// @param  last      - offset past the end of the range from opts.offset in bytes.
+    /// @param  flags     - flags of the msync.
+    /// @throw  std::runtime_error if can not write the pages.
+    static void msync_range(pointer p_buf, size_t buf_first, size_t length,
+                            size_t first, size_t last, int flags)
+    {
+        const size_t page_size = memory_page_size();
+        // The mapping is aligned with the memory page, so is the intersection.
+        first -= first % page_size;
+        first = (first > buf_first) ? first : buf_first;
+        last = (last < buf_first + length) ? last : buf_first + length;
+        if (first < last && ::msync((char*)p_buf + (first - buf_first), last - first, flags) == -1) {
+            throw std::runtime_error("flush: error write mapping to file: " + str_error_r(errno));
+        }
+    }
 };
 
-/// @brief  Memory page size calculation.
-/// @return Memory page size.
-inline long memory_page_size()
-{
-    return ::sysconf(_SC_PAGE_SIZE);
-}
 
 inline void* mmap_buf(void* p_addr, const size_t length, const int prot, const int flags, const int fd, const off_t offset)
 {
@@ -290,6 +1224,7 @@ inline int munmap_buf(void* p_addr, const size_t length)
 
 } // namespace utils
 } // namespace details
+MFCNT_INLINE_NAMESPACE_END
 } // namespace mfcnt
 
 #endif /* _MMAP_CONTAINERS_MFCNT_UTILS_H */
@@ -0,0 +1,398 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_APPEND_LOG_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_APPEND_LOG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "mfcnt/types.h"
+#include "mfcnt/mmap_deque_view.h"
+#include "mfcnt/mmap_record_view.h"
+#include "mfcnt/details/utils.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics should be lock-free to be shared by the mappings");
+
+/// @brief  Header of the file of the append log, it takes the first page of the file.
+struct append_log_header
+{
+    uint64_t magic;
+    uint64_t capacity;      // Size of the records area in bytes.
+    std::atomic<uint64_t> tail; // Offset of the next reservation in the records area.
+};
+
+/// @brief  Layout of the records of the append log.
+/// @details    Each record starts at the multiple of 8 bytes with the 64-bit
+///             word of the marker in the high half and the length of the
+///             payload in the low half. The reservation stores the word with
+///             the reserved marker, the commit replaces it after the payload
+///             is written. The zero word of the preallocated file is the space
+///             that is not reserved yet.
+struct append_log_format
+{
+    /// Size of the header page, the records area follows it.
+    static constexpr size_t header_size = utils::kMinPageSize;
+
+    /// Marker of the committed record.
+    static constexpr uint64_t commit_marker = 0x434d4954;
+
+    /// Marker of the record that is reserved and not committed yet.
+    static constexpr uint64_t reserved_marker = 0x52535256;
+
+    /// Marker of the reservation dropped by the writer, the readers skip it.
+    static constexpr uint64_t abandoned_marker = 0x41424e44;
+
+    /// Marker of the end of the log, the following bytes are not used.
+    static constexpr uint64_t end_marker = 0x454e4421;
+
+    static constexpr size_t word_size = sizeof(uint64_t);
+
+    /// Size of the record with the payload of the length, a multiple of the word.
+    static size_t record_size(size_t length) { return word_size + (length + word_size - 1) / word_size * word_size; }
+
+    static uint64_t make_word(uint64_t marker, size_t length) { return (marker << 32) | length; }
+};
+
+} // namespace details
+
+/// @brief  Space of the record reserved in the append log.
+struct mmap_log_reservation
+{
+    /// Pointer to the payload in the mapping, nullptr if the log is full.
+    char* data;
+
+    /// Length of the payload.
+    size_t size;
+
+    /// Offset of the record in the records area.
+    size_t offset;
+};
+
+/// @brief  Log of the records appended by many threads directly to the mapping.
+/// @details    The file is preallocated and mapped with mode::RW_SHARED. The
+///             thread reserves the space of the record by one atomic fetch_add
+///             on the tail offset, writes the payload to the mapping and
+///             commits the record by storing its header word, so the readers
+///             of the file, see mmap_log_view, read only the complete records.
+///             The record that does not fit the log stores the end marker, so
+///             the readers stop at the end of the log.
+/// @note   The file is written by one mmap_append_log object, the threads of
+///         the process share it. The tail is stored in the header of the file,
+///         when the log is opened again, the reservations that were not
+///         committed are marked as abandoned and the readers skip them, the
+///         records committed after them are kept.
+class mmap_append_log
+{
+    typedef details::append_log_header                                      header_type;
+    typedef details::append_log_format                                      format;
+    typedef details::utils::mmap_buffer<char*, details::utils::kMinPageSize> _mapper;
+
+    /// "MFCNTLOG" in the little-endian byte order.
+    static constexpr uint64_t s_magic = 0x474f4c544e43464dULL;
+
+public:
+    typedef size_t  size_type;
+
+    /// @brief  Constructor, open the log or create and preallocate it.
+    /// @param  file_path - path to the file of the log.
+    /// @param  capacity  - size of the records area in bytes, it is used if the
+    ///                     file is created and is rounded up to the multiple of 8.
+    /// @throw  std::runtime_error if can not open, allocate or map the file or the
+    ///         file is not the log.
+    mmap_append_log(const std::string& file_path, size_type capacity)
+        : m_p_header(nullptr)
+        , m_p_records(nullptr)
+        , m_capacity(0)
+    {
+        m_buffer.open(file_path, O_CLOEXEC | O_LARGEFILE | O_RDWR | O_CREAT, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FILE);
+        try {
+            size_t file_size = m_buffer.file_size();
+            if (file_size == 0) {
+                capacity = (capacity + format::word_size - 1) / format::word_size * format::word_size;
+                file_size = format::header_size + capacity;
+                m_buffer.resize_file(file_size);
+                m_buffer.remap_whole(file_size);
+
+                header_type* p_header = reinterpret_cast<header_type*>(m_buffer.p_whole);
+                p_header->capacity = capacity;
+                p_header->tail.store(0, std::memory_order_relaxed);
+                p_header->magic = s_magic;
+            } else {
+                m_buffer.remap_whole(file_size);
+            }
+
+            const header_type* p_header = reinterpret_cast<const header_type*>(m_buffer.p_whole);
+            if (file_size < format::header_size || p_header->magic != s_magic
+                || file_size != format::header_size + p_header->capacity) {
+                throw std::runtime_error("mmap_append_log: file '" + file_path + "' is not the log");
+            }
+            m_p_header = reinterpret_cast<header_type*>(m_buffer.p_whole);
+            m_p_records = m_buffer.p_whole + format::header_size;
+            m_capacity = p_header->capacity;
+        } catch (...) {
+            m_buffer.close();
+            throw;
+        }
+        recover_tail();
+    }
+
+    /// The threads share one log, so the log is neither copyable nor movable.
+    mmap_append_log(const mmap_append_log& orig) = delete;
+
+    virtual ~mmap_append_log() { m_buffer.close(); }
+
+    /// @brief  Append the record.
+    /// @return false if the log is full.
+    /// @throw  std::runtime_error if the record is longer than 4 GB.
+    bool append(const void* p_data, size_type size)
+    {
+        const mmap_log_reservation res = reserve(size);
+        if (res.data == nullptr) {
+            return false;
+        }
+        std::memcpy(res.data, p_data, size);
+        commit(res);
+        return true;
+    }
+
+    /// @brief  Size of the records area in bytes.
+    size_type capacity() const { return m_capacity; }
+
+    /// @brief  Publish the reserved record to the readers.
+    void commit(const mmap_log_reservation& res)
+    {
+        assert(res.data != nullptr);
+        word(res.offset).store(format::make_word(format::commit_marker, res.size), std::memory_order_release);
+    }
+
+    /// @brief  Reserve the space of the record, the payload is written to the reserved space and committed.
+    /// @details    The reservations of the threads do not wait for each other,
+    ///             the reader stops at the first record which is not committed.
+    ///             The reservation is stamped with its length, so the records
+    ///             committed after it are found when the log is opened again.
+    /// @param  size - length of the payload.
+    /// @return The reservation, its data is nullptr if the log is full.
+    /// @throw  std::runtime_error if the record is longer than 4 GB.
+    mmap_log_reservation reserve(size_type size)
+    {
+        if (size > UINT32_MAX) {
+            throw std::runtime_error("mmap_append_log: record is longer than 4 GB");
+        }
+
+        const size_t record_size = format::record_size(size);
+        const size_t offset = m_p_header->tail.fetch_add(record_size, std::memory_order_relaxed);
+        if (offset + record_size > m_capacity) {
+            // The first record that does not fit marks the end of the log.
+            if (offset + format::word_size <= m_capacity) {
+                word(offset).store(format::make_word(format::end_marker, 0), std::memory_order_release);
+            }
+            return mmap_log_reservation{nullptr, size, offset};
+        }
+        word(offset).store(format::make_word(format::reserved_marker, size), std::memory_order_relaxed);
+        return mmap_log_reservation{m_p_records + offset + format::word_size, size, offset};
+    }
+
+    /// @brief  Size of the reserved part of the records area in bytes.
+    size_type size() const
+    {
+        return m_p_header ? std::min<size_t>(m_p_header->tail.load(std::memory_order_relaxed), m_capacity) : 0;
+    }
+
+    /// @brief  Write the log to the storage.
+    /// @throw  std::runtime_error if can not synchronize the file.
+    void sync() const
+    {
+        m_buffer.flush(0, m_buffer.whole_size, false);
+        m_buffer.sync();
+    }
+
+private:
+    std::atomic<uint64_t>& word(size_t offset) const
+    {
+        return *reinterpret_cast<std::atomic<uint64_t>*>(m_p_records + offset);
+    }
+
+    /// @brief  Set the tail past the last record, the reservations that were
+    ///         not committed are marked as abandoned.
+    /// @details    The scan stops at the space that is not reserved or at the
+    ///             end of the log. The space reserved by the writer that died
+    ///             before the reservation was stamped has no length, so the
+    ///             records after it are dropped.
+    void recover_tail()
+    {
+        size_t offset = 0;
+        while (offset + format::word_size <= m_capacity) {
+            const uint64_t w = word(offset).load(std::memory_order_acquire);
+            const uint64_t marker = w >> 32;
+            if (marker == format::reserved_marker) {
+                word(offset).store(format::make_word(format::abandoned_marker, w & UINT32_MAX), std::memory_order_relaxed);
+            } else if (marker != format::commit_marker && marker != format::abandoned_marker) {
+                break;
+            }
+            offset += format::record_size(w & UINT32_MAX);
+        }
+        // The dropped reservations are cleared, so they are not read as the records.
+        const size_t tail = std::min<size_t>(m_p_header->tail.load(std::memory_order_relaxed), m_capacity);
+        if (tail > offset) {
+            std::memset(m_p_records + offset, 0, tail - offset);
+        }
+        m_p_header->tail.store(offset, std::memory_order_relaxed);
+    }
+
+    _mapper m_buffer;
+
+    header_type* m_p_header;
+    char* m_p_records;
+    size_t m_capacity;
+};
+
+/// @brief  Read only view of the committed records of the append log.
+/// @details    The view maps the records area of the file, so it is read
+///             while the log is appended. The records are read up to the first
+///             one which is not committed yet, the reader continues from the
+///             returned offset later. The abandoned reservations are skipped.
+/// @tparam TCount - number of the bytes in the window.
+template<size_t TCount = 4*1024*1024>
+class mmap_log_view
+{
+    typedef details::append_log_format      format;
+    typedef mmap_deque_view<char, TCount>   data_view;
+
+public:
+    typedef mmap_record     record_type;
+    typedef size_t          size_type;
+
+    mmap_log_view() {}
+
+    /// @brief  Constructor.
+    /// @param  file_path - path to the file of the log.
+    /// @param  policy    - policy of mapping the file.
+    /// @throw  std::runtime_error if can not open or map the file.
+    explicit mmap_log_view(const std::string& file_path, map_policy policy = map_policy::SEGMENTED)
+        : m_data(file_path, format::header_size, mode::R_ONLY, policy)
+    {}
+
+    /// @brief  Size of the records area in bytes.
+    size_type capacity() const { return m_data.size(); }
+
+    /// @brief  Call the function object (record) for each committed record.
+    /// @details    The payload of the record is valid until the next record is read.
+    /// @param  offset - offset of the first record in the records area.
+    /// @param  func   - function object (record).
+    /// @return Offset past the last read record, the reading continues from it.
+    template<typename TFunc>
+    size_type read(size_type offset, const TFunc& func) const
+    {
+        record_type rec;
+        offset = skip_abandoned(offset);
+        while (next(offset, rec)) {
+            func(rec);
+            offset = skip_abandoned(offset + format::record_size(rec.size()));
+        }
+        return offset;
+    }
+
+    /// @brief  Read the record.
+    /// @param  offset - offset of the record in the records area, the abandoned
+    ///                  reservations at the offset are skipped.
+    /// @param  rec    - the record if it is committed.
+    /// @return true if the record is committed, false if it is not yet or the log ends.
+    bool next(size_type offset, record_type& rec) const
+    {
+        offset = skip_abandoned(offset);
+        if (offset + format::word_size > m_data.size()) {
+            return false;
+        }
+
+        const uint64_t w = load_word(offset);
+        if ((w >> 32) != format::commit_marker) {
+            return false;
+        }
+
+        rec.m_pos = offset + format::word_size;
+        rec.m_size = w & UINT32_MAX;
+        rec.m_copy.clear();
+        rec.m_p_first = nullptr;
+        if (rec.m_size == 0) {
+            return true;
+        }
+        if (m_data.window_first(rec.m_pos) == m_data.window_first(rec.m_pos + rec.m_size - 1)) {
+            rec.m_p_first = &m_data[rec.m_pos];
+        } else {
+            rec.m_copy.resize(rec.m_size);
+            char* p_out = &rec.m_copy[0];
+            for (const typename data_view::segment_range::value_type& seg : m_data.segments(rec.m_pos, rec.m_size)) {
+                std::memcpy(p_out, seg.first, seg.size());
+                p_out += seg.size();
+            }
+        }
+        return true;
+    }
+
+    /// @brief  Reset the counters of the mapping activity.
+    void reset_stats() { m_data.reset_stats(); }
+
+    /// @brief  Counters of the mapping activity of the view.
+    mfcnt::stats stats() const { return m_data.stats(); }
+
+    void swap(mmap_log_view& orig) { m_data.swap(orig.m_data); }
+
+private:
+    uint64_t load_word(size_type offset) const
+    {
+        // The words are aligned with 8 bytes, so the word does not cross the windows.
+        return reinterpret_cast<const std::atomic<uint64_t>&>(m_data[offset]).load(std::memory_order_acquire);
+    }
+
+    /// @brief  Offset of the first slot at the offset which is not abandoned.
+    size_type skip_abandoned(size_type offset) const
+    {
+        while (offset + format::word_size <= m_data.size()) {
+            const uint64_t w = load_word(offset);
+            if ((w >> 32) != format::abandoned_marker) {
+                break;
+            }
+            offset += format::record_size(w & UINT32_MAX);
+        }
+        return offset;
+    }
+
+    data_view m_data;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_APPEND_LOG_H */
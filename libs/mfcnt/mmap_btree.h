@@ -0,0 +1,747 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_BTREE_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_BTREE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mfcnt/types.h"
+#include "mfcnt/details/utils.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+/// @brief  Header of the file of the B+tree, it takes the page 0 of the file.
+struct btree_header
+{
+    uint64_t magic;
+    uint64_t key_size;
+    uint64_t value_size;
+    uint64_t page_size;
+    uint64_t root;          // Page of the root node.
+    uint64_t height;        // Number of the levels of the internal nodes.
+    uint64_t count;         // Number of the elements.
+    uint64_t page_count;    // Number of the pages in use, the free pages included.
+    uint64_t free_page;     // First page of the list of the free pages, 0 if there are none.
+};
+
+/// @brief  Header of the node of the B+tree.
+struct btree_node
+{
+    uint32_t level;         // Level of the node, 0 is the leaf.
+    uint32_t count;         // Number of the keys.
+    uint64_t next;          // Next leaf or the next free page, 0 if there is none.
+    uint64_t prev;          // Previous leaf, 0 if there is none.
+};
+
+template<typename TTree>
+class mmap_btree_iterator;
+
+} // namespace details
+
+/// @brief  B+tree of the unique keys stored in the file.
+/// @details    The nodes take the memory pages of the file, so each node is
+///             read by one page fault and the tree is used without the
+///             deserialization. The leaves hold the keys and the values and
+///             are linked in the order of the keys, so the range scan reads the
+///             leaves one after another and asks the kernel to read the next
+///             leaf ahead. The whole file is mapped and is extended by doubling.
+/// @note   The erased keys do not merge the nodes, the node is freed when it
+///         becomes empty, and its page is reused by the following inserts.
+/// @note   The tree is not thread-safe and the modifications invalidate the
+///         iterators. The keys and the values are stored as the bytes with the
+///         native byte order, so they should be trivially copyable.
+/// @tparam TKey     - type of the keys.
+/// @tparam TValue   - type of the values.
+/// @tparam TCompare - comparator of the keys.
+template<typename TKey, typename TValue, typename TCompare = std::less<TKey>>
+class mmap_btree
+{
+    static_assert(std::is_trivially_copyable<TKey>::value, "the key should be trivially copyable");
+    static_assert(std::is_trivially_copyable<TValue>::value, "the value should be trivially copyable");
+
+    template<typename TTree>
+    friend class details::mmap_btree_iterator;
+
+    typedef details::btree_header                                           header_type;
+    typedef details::btree_node                                             node_type;
+    typedef details::utils::mmap_buffer<char*, details::utils::kMinPageSize> _mapper;
+
+    /// "MFCNTBPT" in the little-endian byte order.
+    static constexpr uint64_t s_magic = 0x545042544e43464dULL;
+
+    /// Path from the root to the node: the page of the internal node and the number of the child.
+    typedef std::vector<std::pair<uint64_t, size_t>> path_type;
+
+public:
+    typedef TKey                                            key_type;
+    typedef TValue                                          mapped_type;
+    typedef std::pair<TKey, TValue>                         value_type;
+    typedef TCompare                                        key_compare;
+    typedef details::mmap_btree_iterator<mmap_btree>        const_iterator;
+    typedef size_t                                          size_type;
+
+    mmap_btree()
+        : m_page_size(0)
+        , m_leaf_capacity(0)
+        , m_inner_capacity(0)
+        , m_prefetch(true)
+    {}
+
+    /// @brief  Constructor, open the tree or create the empty one.
+    /// @param  file_path - path to the file, the file is created if it does not exist.
+    /// @param  comp      - comparator of the keys.
+    /// @throw  std::runtime_error if can not open or map the file, the file is
+    ///         not the tree of these types or the page can not hold three keys.
+    explicit mmap_btree(const std::string& file_path, const key_compare& comp = key_compare())
+        : m_page_size(details::utils::memory_page_size())
+        , m_leaf_capacity((m_page_size - sizeof(node_type)) / (sizeof(key_type) + sizeof(mapped_type)))
+        , m_inner_capacity((m_page_size - sizeof(node_type) - sizeof(uint64_t)) / (sizeof(key_type) + sizeof(uint64_t)))
+        , m_comp(comp)
+        , m_prefetch(true)
+    {
+        if (m_leaf_capacity < 3 || m_inner_capacity < 3) {
+            throw std::runtime_error("mmap_btree: memory page can not hold three keys");
+        }
+
+        m_buffer.open(file_path, O_CLOEXEC | O_LARGEFILE | O_RDWR | O_CREAT, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FILE);
+        try {
+            const size_t file_size = m_buffer.file_size();
+            if (file_size == 0) {
+                init();
+                return;
+            }
+
+            m_buffer.remap_whole(file_size);
+            const header_type& h = header();
+            if (file_size < m_page_size || h.magic != s_magic || h.key_size != sizeof(key_type)
+                || h.value_size != sizeof(mapped_type) || h.page_size != m_page_size) {
+                throw std::runtime_error("mmap_btree: file '" + file_path
+                                         + "' is not the tree of these key and value types");
+            }
+            if (h.page_count * m_page_size > file_size || h.root == 0 || h.root >= h.page_count) {
+                throw std::runtime_error("mmap_btree: file '" + file_path + "' is corrupted");
+            }
+        } catch (...) {
+            m_buffer.close();
+            throw;
+        }
+    }
+
+    /// The container owns the mapping, so it is not copyable.
+    mmap_btree(const mmap_btree& orig) = delete;
+
+    mmap_btree(mmap_btree&& orig)
+        : mmap_btree()
+    {
+        swap(orig);
+    }
+
+    virtual ~mmap_btree() { m_buffer.close(); }
+
+    /// @throw  std::out_of_range if there is no such key.
+    mapped_type at(const key_type& key) const
+    {
+        const const_iterator it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("mmap_btree: key is not found");
+        }
+        return it->second;
+    }
+
+    const_iterator begin() const
+    {
+        if (! is_open()) {
+            return end();
+        }
+
+        uint64_t page = header().root;
+        while (node(page).level != 0) {
+            page = child(page, 0);
+        }
+        return const_iterator(*this, page, 0);
+    }
+
+    const_iterator cbegin() const { return begin(); }
+
+    const_iterator cend() const { return end(); }
+
+    bool contains(const key_type& key) const { return (find(key) != end()); }
+
+    bool empty() const { return (size() == 0); }
+
+    const_iterator end() const { return const_iterator(*this, 0, 0); }
+
+    /// @brief  Erase the key.
+    /// @return true if the key was erased.
+    bool erase(const key_type& key)
+    {
+        if (! is_open()) {
+            return false;
+        }
+
+        path_type path;
+        const uint64_t leaf = descend(key, &path);
+        const size_t pos = leaf_lower_bound(leaf, key);
+        node_type& n = node(leaf);
+        if (pos == n.count || m_comp(key, leaf_key(leaf, pos))) {
+            return false;
+        }
+
+        move_entries(leaf, pos, pos + 1, n.count - pos - 1);
+        --n.count;
+        --header().count;
+        if (n.count == 0 && ! path.empty()) {
+            remove_leaf(leaf, path);
+        }
+        return true;
+    }
+
+    /// @brief  Iterator to the key, end() if there is no such key.
+    const_iterator find(const key_type& key) const
+    {
+        const const_iterator it = lower_bound(key);
+        return (it != end() && ! m_comp(key, it->first)) ? it : end();
+    }
+
+    /// @brief  Number of the levels of the internal nodes, 0 if the root is the leaf.
+    size_type height() const { return is_open() ? header().height : 0; }
+
+    /// @brief  Insert the key with the value if there is no such key.
+    /// @return true if the key was inserted.
+    /// @throw  std::runtime_error if can not extend the file.
+    bool insert(const key_type& key, const mapped_type& value) { return insert(key, value, false); }
+
+    /// @brief  Insert the key or replace its value.
+    /// @return true if the key was inserted.
+    /// @throw  std::runtime_error if can not extend the file.
+    bool insert_or_assign(const key_type& key, const mapped_type& value) { return insert(key, value, true); }
+
+    /// @brief  The default constructed tree has no file.
+    bool is_open() const { return (m_buffer.p_whole != nullptr); }
+
+    /// @brief  Iterator to the first key that is not less than the key.
+    const_iterator lower_bound(const key_type& key) const
+    {
+        if (! is_open()) {
+            return end();
+        }
+
+        const uint64_t leaf = descend(key, nullptr);
+        return const_iterator(*this, leaf, leaf_lower_bound(leaf, key));
+    }
+
+    /// @brief  Enable the read-ahead of the next leaf during the iteration.
+    /// @details    The read-ahead is enabled by default, it costs a system call
+    ///             per leaf, so the scans of the tree in the page cache may
+    ///             disable it.
+    void set_prefetch(bool prefetch) { m_prefetch = prefetch; }
+
+    size_type size() const { return is_open() ? header().count : 0; }
+
+    void swap(mmap_btree& orig)
+    {
+        m_buffer.swap(orig.m_buffer);
+        std::swap(m_page_size, orig.m_page_size);
+        std::swap(m_leaf_capacity, orig.m_leaf_capacity);
+        std::swap(m_inner_capacity, orig.m_inner_capacity);
+        std::swap(m_comp, orig.m_comp);
+        std::swap(m_prefetch, orig.m_prefetch);
+    }
+
+    /// @brief  Write the tree to the storage.
+    /// @throw  std::runtime_error if can not synchronize the file.
+    void sync() const
+    {
+        m_buffer.flush(0, m_buffer.whole_size, false);
+        m_buffer.sync();
+    }
+
+    /// @brief  Iterator to the first key that is greater than the key.
+    const_iterator upper_bound(const key_type& key) const
+    {
+        const_iterator it = lower_bound(key);
+        if (it != end() && ! m_comp(key, it->first)) {
+            ++it;
+        }
+        return it;
+    }
+
+    mmap_btree& operator=(const mmap_btree& orig) = delete;
+
+    mmap_btree& operator=(mmap_btree&& orig)
+    {
+        if (this != &orig) {
+            mmap_btree(std::move(orig)).swap(*this);
+        }
+        return *this;
+    }
+
+private:
+    /// @brief  Create the header and the empty root leaf in the empty file.
+    void init()
+    {
+        grow(2);
+        header_type& h = header();
+        h.key_size = sizeof(key_type);
+        h.value_size = sizeof(mapped_type);
+        h.page_size = m_page_size;
+        h.root = 1;
+        h.height = 0;
+        h.count = 0;
+        h.page_count = 2;
+        h.free_page = 0;
+        h.magic = s_magic;
+    }
+
+    /// @brief  Extend the file and the mapping to hold the pages.
+    void grow(size_t page_count)
+    {
+        const size_t size = page_count * m_page_size;
+        m_buffer.resize_file(size);
+        m_buffer.remap_whole(size);
+    }
+
+    /// @brief  Take the free page or the new one, the pointers to the mapping are invalidated.
+    uint64_t alloc_page()
+    {
+        uint64_t page = header().free_page;
+        if (page != 0) {
+            header().free_page = node(page).next;
+        } else {
+            page = header().page_count;
+            if ((page + 1) * m_page_size > m_buffer.whole_size) {
+                grow(2 * page);
+            }
+            ++header().page_count;
+        }
+        std::memset(page_ptr(page), 0, m_page_size);
+        return page;
+    }
+
+    void free_page(uint64_t page)
+    {
+        node(page).next = header().free_page;
+        header().free_page = page;
+    }
+
+    char* page_ptr(uint64_t page) const { return m_buffer.p_whole + page * m_page_size; }
+
+    header_type& header() const { return *reinterpret_cast<header_type*>(m_buffer.p_whole); }
+
+    node_type& node(uint64_t page) const { return *reinterpret_cast<node_type*>(page_ptr(page)); }
+
+    // The keys, the values and the children are accessed by memcpy, they are not aligned.
+
+    char* key_ptr(uint64_t page, size_t i) const { return page_ptr(page) + sizeof(node_type) + i * sizeof(key_type); }
+
+    char* value_ptr(uint64_t page, size_t i) const
+    {
+        return page_ptr(page) + sizeof(node_type) + m_leaf_capacity * sizeof(key_type) + i * sizeof(mapped_type);
+    }
+
+    char* child_ptr(uint64_t page, size_t i) const
+    {
+        return page_ptr(page) + sizeof(node_type) + m_inner_capacity * sizeof(key_type) + i * sizeof(uint64_t);
+    }
+
+    key_type leaf_key(uint64_t page, size_t i) const { return load<key_type>(key_ptr(page, i)); }
+
+    key_type inner_key(uint64_t page, size_t i) const { return load<key_type>(key_ptr(page, i)); }
+
+    mapped_type value(uint64_t page, size_t i) const { return load<mapped_type>(value_ptr(page, i)); }
+
+    uint64_t child(uint64_t page, size_t i) const { return load<uint64_t>(child_ptr(page, i)); }
+
+    template<typename TTp>
+    static TTp load(const char* p)
+    {
+        TTp val;
+        std::memcpy(&val, p, sizeof(val));
+        return val;
+    }
+
+    template<typename TTp>
+    static void store(char* p, const TTp& val) { std::memcpy(p, &val, sizeof(val)); }
+
+    /// @brief  Move the entries of the leaf within the leaf.
+    void move_entries(uint64_t page, size_t dst, size_t src, size_t count)
+    {
+        std::memmove(key_ptr(page, dst), key_ptr(page, src), count * sizeof(key_type));
+        std::memmove(value_ptr(page, dst), value_ptr(page, src), count * sizeof(mapped_type));
+    }
+
+    /// @brief  Position of the first key of the leaf that is not less than the key.
+    size_t leaf_lower_bound(uint64_t page, const key_type& key) const
+    {
+        size_t first = 0;
+        size_t count = node(page).count;
+        while (count > 0) {
+            const size_t step = count / 2;
+            if (m_comp(leaf_key(page, first + step), key)) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    /// @brief  Number of the child of the internal node that holds the key.
+    size_t inner_child(uint64_t page, const key_type& key) const
+    {
+        size_t first = 0;
+        size_t count = node(page).count;
+        while (count > 0) {
+            const size_t step = count / 2;
+            if (! m_comp(key, inner_key(page, first + step))) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    /// @brief  Find the leaf that holds the key.
+    /// @param  key    - key.
+    /// @param  p_path - path to the leaf, it is not stored if nullptr.
+    uint64_t descend(const key_type& key, path_type* p_path) const
+    {
+        uint64_t page = header().root;
+        while (node(page).level != 0) {
+            const size_t i = inner_child(page, key);
+            if (p_path) {
+                p_path->emplace_back(page, i);
+            }
+            page = child(page, i);
+        }
+        return page;
+    }
+
+    bool insert(const key_type& key, const mapped_type& value, bool assign)
+    {
+        assert(is_open());
+
+        path_type path;
+        const uint64_t leaf = descend(key, &path);
+        const size_t pos = leaf_lower_bound(leaf, key);
+        if (pos < node(leaf).count && ! m_comp(key, leaf_key(leaf, pos))) {
+            if (assign) {
+                store(value_ptr(leaf, pos), value);
+            }
+            return false;
+        }
+
+        if (node(leaf).count < m_leaf_capacity) {
+            insert_entry(leaf, pos, key, value);
+        } else {
+            split_leaf(leaf, pos, key, value, path);
+        }
+        ++header().count;
+        return true;
+    }
+
+    void insert_entry(uint64_t leaf, size_t pos, const key_type& key, const mapped_type& value)
+    {
+        node_type& n = node(leaf);
+        move_entries(leaf, pos + 1, pos, n.count - pos);
+        store(key_ptr(leaf, pos), key);
+        store(value_ptr(leaf, pos), value);
+        ++n.count;
+    }
+
+    /// @brief  Split the full leaf into two halves and insert the entry into one of them.
+    void split_leaf(uint64_t leaf, size_t pos, const key_type& key, const mapped_type& value, path_type& path)
+    {
+        const uint64_t right = alloc_page();
+        const size_t left_count = (m_leaf_capacity + 1) / 2;
+        const size_t moved = m_leaf_capacity - left_count;
+
+        node_type& l = node(leaf);
+        node_type& r = node(right);
+        std::memcpy(key_ptr(right, 0), key_ptr(leaf, left_count), moved * sizeof(key_type));
+        std::memcpy(value_ptr(right, 0), value_ptr(leaf, left_count), moved * sizeof(mapped_type));
+        l.count = left_count;
+        r.count = moved;
+
+        r.level = 0;
+        r.next = l.next;
+        r.prev = leaf;
+        if (l.next != 0) {
+            node(l.next).prev = right;
+        }
+        l.next = right;
+
+        if (pos <= left_count) {
+            insert_entry(leaf, pos, key, value);
+        } else {
+            insert_entry(right, pos - left_count, key, value);
+        }
+        insert_child(path, leaf_key(right, 0), right);
+    }
+
+    /// @brief  Insert the separator and the new right node into the parent of the path.
+    void insert_child(path_type& path, key_type separator, uint64_t right)
+    {
+        while (! path.empty()) {
+            const uint64_t page = path.back().first;
+            const size_t i = path.back().second;
+            path.pop_back();
+
+            const size_t count = node(page).count;
+            if (count < m_inner_capacity) {
+                std::memmove(key_ptr(page, i + 1), key_ptr(page, i), (count - i) * sizeof(key_type));
+                std::memmove(child_ptr(page, i + 2), child_ptr(page, i + 1), (count - i) * sizeof(uint64_t));
+                store(key_ptr(page, i), separator);
+                store(child_ptr(page, i + 1), right);
+                ++node(page).count;
+                return;
+            }
+
+            // The full node is split: the keys of the node and the separator are
+            // gathered, the middle key is moved up to the parent.
+            std::vector<key_type> keys(count + 1);
+            std::vector<uint64_t> children(count + 2);
+            for (size_t k = 0, j = 0; k <= count; ++k) {
+                keys[k] = (k == i) ? separator : inner_key(page, j++);
+            }
+            for (size_t k = 0, j = 0; k <= count + 1; ++k) {
+                children[k] = (k == i + 1) ? right : child(page, j++);
+            }
+
+            const uint64_t new_page = alloc_page();
+            const size_t mid = (count + 1) / 2;
+            const size_t right_count = count - mid;
+            node(new_page).level = node(page).level;
+            node(page).count = mid;
+            node(new_page).count = right_count;
+            for (size_t k = 0; k < mid; ++k) {
+                store(key_ptr(page, k), keys[k]);
+            }
+            for (size_t k = 0; k <= mid; ++k) {
+                store(child_ptr(page, k), children[k]);
+            }
+            for (size_t k = 0; k < right_count; ++k) {
+                store(key_ptr(new_page, k), keys[mid + 1 + k]);
+            }
+            for (size_t k = 0; k <= right_count; ++k) {
+                store(child_ptr(new_page, k), children[mid + 1 + k]);
+            }
+
+            separator = keys[mid];
+            right = new_page;
+        }
+
+        // The root was split, the new root is above it.
+        const uint64_t old_root = header().root;
+        const uint64_t root = alloc_page();
+        node(root).level = node(old_root).level + 1;
+        node(root).count = 1;
+        store(key_ptr(root, 0), separator);
+        store(child_ptr(root, 0), old_root);
+        store(child_ptr(root, 1), right);
+        header().root = root;
+        ++header().height;
+    }
+
+    /// @brief  Unlink the empty leaf and remove it from the parents, the empty parents are removed as well.
+    void remove_leaf(uint64_t leaf, path_type& path)
+    {
+        node_type& n = node(leaf);
+        if (n.prev != 0) {
+            node(n.prev).next = n.next;
+        }
+        if (n.next != 0) {
+            node(n.next).prev = n.prev;
+        }
+        free_page(leaf);
+
+        while (! path.empty()) {
+            const uint64_t page = path.back().first;
+            const size_t i = path.back().second;
+            path.pop_back();
+
+            const size_t count = node(page).count;
+            if (count == 0) {
+                // The only child was removed.
+                if (path.empty()) {
+                    // The root is the empty leaf again.
+                    node(page).level = 0;
+                    node(page).next = 0;
+                    node(page).prev = 0;
+                    header().height = 0;
+                    return;
+                }
+                free_page(page);
+                continue;
+            }
+
+            // The child i and the key that separates it from its neighbour are removed.
+            const size_t key_pos = (i > 0) ? i - 1 : 0;
+            std::memmove(key_ptr(page, key_pos), key_ptr(page, key_pos + 1), (count - key_pos - 1) * sizeof(key_type));
+            std::memmove(child_ptr(page, i), child_ptr(page, i + 1), (count - i) * sizeof(uint64_t));
+            --node(page).count;
+            break;
+        }
+
+        // The root with one child is replaced by the child.
+        uint64_t root = header().root;
+        while (node(root).level != 0 && node(root).count == 0) {
+            const uint64_t only_child = child(root, 0);
+            free_page(root);
+            root = only_child;
+            --header().height;
+        }
+        header().root = root;
+    }
+
+    /// @brief  Ask the kernel to read the leaf ahead.
+    void prefetch(uint64_t page) const
+    {
+        if (m_prefetch && page != 0) {
+            m_buffer.advise(advice::WILLNEED, page * m_page_size, (page + 1) * m_page_size);
+        }
+    }
+
+    _mapper m_buffer;
+
+    size_t m_page_size;
+    size_t m_leaf_capacity;
+    size_t m_inner_capacity;
+    key_compare m_comp;
+    bool m_prefetch;
+};
+
+namespace details {
+
+/// @brief  Forward iterator over the elements of mmap_btree in the order of the keys.
+/// @details    The element is copied from the leaf when the iterator is moved.
+template<typename TTree>
+class mmap_btree_iterator
+{
+public:
+    typedef std::forward_iterator_tag               iterator_category;
+    typedef typename TTree::value_type              value_type;
+    typedef const value_type*                       pointer;
+    typedef const value_type&                       reference;
+    typedef size_t                                  size_type;
+    typedef ptrdiff_t                               difference_type;
+
+    mmap_btree_iterator()
+        : m_p_tree(nullptr)
+        , m_page(0)
+        , m_pos(0)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  tree - tree.
+    /// @param  page - page of the leaf, 0 is the end.
+    /// @param  pos  - position in the leaf, the iterator moves to the next leaf if it is past the end.
+    mmap_btree_iterator(const TTree& tree, uint64_t page, size_t pos)
+        : m_p_tree(&tree)
+        , m_page(page)
+        , m_pos(pos)
+    {
+        if (m_page != 0) {
+            m_p_tree->prefetch(m_p_tree->node(m_page).next);
+            settle();
+        }
+    }
+
+    reference operator*() const { return m_value; }
+
+    pointer operator->() const { return &m_value; }
+
+    mmap_btree_iterator& operator++()
+    {
+        assert(m_page != 0);
+
+        ++m_pos;
+        settle();
+        return *this;
+    }
+
+    mmap_btree_iterator operator++(int)
+    {
+        mmap_btree_iterator tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+private:
+    /// @brief  Move to the next leaf if the position is past the end of the leaf and load the element.
+    void settle()
+    {
+        while (m_page != 0 && m_pos == m_p_tree->node(m_page).count) {
+            m_page = m_p_tree->node(m_page).next;
+            m_pos = 0;
+            if (m_page != 0) {
+                m_p_tree->prefetch(m_p_tree->node(m_page).next);
+            }
+        }
+        if (m_page != 0) {
+            m_value.first = m_p_tree->leaf_key(m_page, m_pos);
+            m_value.second = m_p_tree->value(m_page, m_pos);
+        }
+    }
+
+public:
+    const TTree* m_p_tree;
+    uint64_t m_page;
+    size_t m_pos;
+    value_type m_value;
+};
+
+template<typename TTree>
+inline bool operator==(const mmap_btree_iterator<TTree>& lhl, const mmap_btree_iterator<TTree>& rhl)
+{
+    return (lhl.m_page == rhl.m_page) && (lhl.m_pos == rhl.m_pos);
+}
+
+template<typename TTree>
+inline bool operator!=(const mmap_btree_iterator<TTree>& lhl, const mmap_btree_iterator<TTree>& rhl)
+{
+    return ! (lhl == rhl);
+}
+
+} // namespace details
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_BTREE_H */
@@ -0,0 +1,454 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_CONCURRENT_HASH_MAP_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_CONCURRENT_HASH_MAP_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "mfcnt/types.h"
+#include "mfcnt/details/hash.h"
+#include "mfcnt/details/utils.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics should be lock-free to be shared by the processes");
+
+/// @brief  Header of the file of the concurrent hash map.
+struct concurrent_hash_header
+{
+    std::atomic<uint64_t> magic;
+    uint64_t key_size;
+    uint64_t value_size;
+    uint64_t capacity;          // Number of the slots, a power of two.
+    uint64_t seed;              // Seed of the hash.
+    std::atomic<uint64_t> count;
+    uint64_t reserved[2];
+};
+
+/// @brief  Slot of the concurrent hash map.
+/// @details    The key word is the complement of the key bytes, so the zero
+///             word of the new file marks the empty slot.
+struct concurrent_hash_slot
+{
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> value;
+};
+
+} // namespace details
+
+/// @brief  Hash map shared by the processes that map the same file.
+/// @details    The file is mapped with mode::RW_SHARED, the slots of the open
+///             addressing table with the linear probing are updated by the
+///             atomic operations on the words of the mapping, so the threads
+///             and the processes insert and update the keys without locks.
+///             The key takes the empty slot by the compare-and-swap of the key
+///             word, the keys are never moved or removed, so the slot of the
+///             key is stable.
+/// @note   The capacity is fixed when the file is created. The map throws
+///         when it is full, rehash() copies the map to the larger table when
+///         no process uses it.
+/// @note   The keys and the values are stored in the 64-bit words with the
+///         native byte order, so they should be trivially copyable and fit
+///         the word. The 8-byte key of all one bits is reserved. The value of
+///         the new key is zero until the value is stored, so a concurrent
+///         reader of the inserted key may see the zero value.
+/// @tparam TKey   - type of the keys.
+/// @tparam TValue - type of the values.
+/// @tparam THash  - function object (key, seed) of the hash that does not depend on the process.
+template<typename TKey, typename TValue, typename THash = details::mmap_hash<TKey>>
+class mmap_concurrent_hash_map
+{
+    static_assert(std::is_trivially_copyable<TKey>::value && sizeof(TKey) <= sizeof(uint64_t),
+                  "the key should be trivially copyable and fit the 64-bit word");
+    static_assert(std::is_trivially_copyable<TValue>::value && sizeof(TValue) <= sizeof(uint64_t),
+                  "the value should be trivially copyable and fit the 64-bit word");
+
+    typedef details::concurrent_hash_header                                 header_type;
+    typedef details::concurrent_hash_slot                                   slot_type;
+    typedef details::utils::mmap_buffer<char*, details::utils::kMinPageSize> _mapper;
+
+    /// "MFCNTCHM" in the little-endian byte order.
+    static constexpr uint64_t s_magic = 0x4d4843544e43464dULL;
+
+    static constexpr uint64_t s_seed = 0x9e3779b97f4a7c15ULL;
+
+public:
+    typedef TKey                                key_type;
+    typedef TValue                              mapped_type;
+    typedef THash                               hasher;
+    typedef size_t                              size_type;
+
+    mmap_concurrent_hash_map()
+        : m_p_header(nullptr)
+        , m_p_slots(nullptr)
+        , m_mask(0)
+    {}
+
+    /// @brief  Constructor, open the map created by create().
+    /// @param  file_path - path to the file of the map.
+    /// @throw  std::runtime_error if can not open or map the file or the file
+    ///         is not the map of these types.
+    explicit mmap_concurrent_hash_map(const std::string& file_path)
+        : m_p_header(nullptr)
+        , m_p_slots(nullptr)
+        , m_mask(0)
+    {
+        m_buffer.open(file_path, mode::RW_SHARED);
+
+        const size_t file_size = m_buffer.file_size();
+        if (file_size < sizeof(header_type)) {
+            m_buffer.close();
+            throw std::runtime_error("mmap_concurrent_hash_map: file '" + file_path + "' is not the hash map");
+        }
+        m_buffer.remap_whole(file_size);
+
+        const header_type* p_header = reinterpret_cast<const header_type*>(m_buffer.p_whole);
+        if (p_header->magic.load(std::memory_order_acquire) != s_magic || p_header->key_size != sizeof(key_type)
+            || p_header->value_size != sizeof(mapped_type)) {
+            m_buffer.close();
+            throw std::runtime_error("mmap_concurrent_hash_map: file '" + file_path
+                                     + "' is not the hash map of these key and value types");
+        }
+        if (p_header->capacity == 0 || (p_header->capacity & (p_header->capacity - 1)) != 0
+            || file_size != sizeof(header_type) + p_header->capacity * sizeof(slot_type)) {
+            m_buffer.close();
+            throw std::runtime_error("mmap_concurrent_hash_map: file '" + file_path + "' is corrupted");
+        }
+
+        m_p_header = reinterpret_cast<header_type*>(m_buffer.p_whole);
+        m_p_slots = reinterpret_cast<slot_type*>(m_buffer.p_whole + sizeof(header_type));
+        m_mask = m_p_header->capacity - 1;
+    }
+
+    /// The container owns the mapping, so it is not copyable.
+    mmap_concurrent_hash_map(const mmap_concurrent_hash_map& orig) = delete;
+
+    mmap_concurrent_hash_map(mmap_concurrent_hash_map&& orig)
+        : mmap_concurrent_hash_map()
+    {
+        swap(orig);
+    }
+
+    virtual ~mmap_concurrent_hash_map()
+    {
+        if (m_buffer.is_open()) {
+            m_buffer.close();
+        }
+    }
+
+    /// @brief  Create the file of the empty map.
+    /// @details    The file should be created before the processes open it,
+    ///             the magic is written last, so the map is not opened until
+    ///             the file is complete.
+    /// @param  file_path - path to the file, the file is overwritten.
+    /// @param  capacity  - number of the slots, it is rounded up to the power of two.
+    /// @throw  std::runtime_error if can not create the file.
+    static void create(const std::string& file_path, size_type capacity)
+    {
+        size_t slot_count = 2;
+        while (slot_count < capacity) {
+            slot_count *= 2;
+        }
+        const size_t file_size = sizeof(header_type) + slot_count * sizeof(slot_type);
+
+        _mapper buffer;
+        buffer.open(file_path, O_CLOEXEC | O_LARGEFILE | O_RDWR | O_CREAT | O_TRUNC,
+                    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FILE);
+        try {
+            buffer.resize_file(file_size);
+            buffer.remap_whole(file_size);
+        } catch (...) {
+            buffer.close();
+            throw;
+        }
+
+        header_type* p_header = reinterpret_cast<header_type*>(buffer.p_whole);
+        p_header->key_size = sizeof(key_type);
+        p_header->value_size = sizeof(mapped_type);
+        p_header->capacity = slot_count;
+        p_header->seed = s_seed;
+        p_header->count.store(0, std::memory_order_relaxed);
+        p_header->magic.store(s_magic, std::memory_order_release);
+        buffer.close();
+    }
+
+    /// @brief  Copy the map to the new file of the larger capacity and replace the file.
+    /// @details    The processes that have the map open keep the old file, so
+    ///             the map should be rehashed while no process uses it.
+    /// @param  file_path - path to the file of the map.
+    /// @param  capacity  - number of the slots of the new file, it is rounded up
+    ///                     to the power of two and should exceed the number of the keys.
+    /// @throw  std::runtime_error if can not read or write the files or the capacity is too small.
+    static void rehash(const std::string& file_path, size_type capacity)
+    {
+        const std::string tmp_path = file_path + ".rehash";
+        {
+            const mmap_concurrent_hash_map src(file_path);
+            if (capacity <= src.size()) {
+                throw std::runtime_error("mmap_concurrent_hash_map: capacity (which is " + std::to_string(capacity)
+                                         + ") does not exceed the number of the keys");
+            }
+            create(tmp_path, capacity);
+            mmap_concurrent_hash_map dst(tmp_path);
+            src.for_each([&dst](const key_type& key, const mapped_type& value) {
+                dst.insert_or_assign(key, value);
+            });
+            dst.sync();
+        }
+        if (std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+            throw std::runtime_error("mmap_concurrent_hash_map: error rename '" + tmp_path + "' to '"
+                                     + file_path + "'");
+        }
+    }
+
+    /// @brief  Number of the slots of the table.
+    size_type capacity() const { return m_p_header ? m_p_header->capacity : 0; }
+
+    /// @brief  Replace the value of the key if it is equal to the expected value.
+    /// @param  key      - key.
+    /// @param  expected - expected value, it gets the current value if they are not equal.
+    /// @param  desired  - new value.
+    /// @return true if the value was replaced, false if the values are not equal
+    ///         or there is no such key.
+    bool compare_exchange(const key_type& key, mapped_type& expected, const mapped_type& desired)
+    {
+        slot_type* p_slot = find_slot(key);
+        if (p_slot == nullptr) {
+            return false;
+        }
+
+        uint64_t expected_word = to_word(expected);
+        if (p_slot->value.compare_exchange_strong(expected_word, to_word(desired), std::memory_order_acq_rel)) {
+            return true;
+        }
+        expected = from_word<mapped_type>(expected_word);
+        return false;
+    }
+
+    bool contains(const key_type& key) const { return (find_slot(key) != nullptr); }
+
+    bool empty() const { return (size() == 0); }
+
+    /// @brief  Add the delta to the value of the key, the new key starts with zero.
+    /// @return The previous value.
+    /// @throw  std::runtime_error if the map is full.
+    mapped_type fetch_add(const key_type& key, const mapped_type& delta)
+    {
+        static_assert(std::is_integral<mapped_type>::value, "fetch_add requires the integral values");
+
+        bool inserted = false;
+        slot_type* p_slot = acquire_slot(key, inserted);
+        if (sizeof(mapped_type) == sizeof(uint64_t)) {
+            return from_word<mapped_type>(p_slot->value.fetch_add(to_word(delta), std::memory_order_acq_rel));
+        }
+
+        // The carry of the narrow value must not reach the unused bytes of the word,
+        // compare_exchange() compares the whole words.
+        uint64_t word = p_slot->value.load(std::memory_order_acquire);
+        while (!p_slot->value.compare_exchange_weak(
+            word, to_word(mapped_type(from_word<mapped_type>(word) + delta)), std::memory_order_acq_rel)) {
+        }
+        return from_word<mapped_type>(word);
+    }
+
+    /// @brief  Find the value of the key.
+    /// @param  key   - key.
+    /// @param  value - the value of the key if it is found.
+    /// @return true if the key is found.
+    bool find(const key_type& key, mapped_type& value) const
+    {
+        const slot_type* p_slot = find_slot(key);
+        if (p_slot == nullptr) {
+            return false;
+        }
+        value = from_word<mapped_type>(p_slot->value.load(std::memory_order_acquire));
+        return true;
+    }
+
+    /// @brief  Call the function object (key, value) for each key of the map.
+    /// @details    The keys inserted concurrently may be skipped.
+    template<typename TFunc>
+    void for_each(const TFunc& func) const
+    {
+        for (size_t i = 0; i < capacity(); ++i) {
+            const uint64_t key_word = m_p_slots[i].key.load(std::memory_order_acquire);
+            if (key_word != 0) {
+                func(from_word<key_type>(~key_word),
+                     from_word<mapped_type>(m_p_slots[i].value.load(std::memory_order_acquire)));
+            }
+        }
+    }
+
+    /// @brief  Insert the key with the value if there is no such key.
+    /// @details    The key is published before its value, so the value replaces
+    ///             the zero of the new slot by the compare-and-swap. If another
+    ///             thread has updated the new key in between, e.g. by fetch_add(),
+    ///             its update is kept and the key counts as inserted by it.
+    /// @return true if the key was inserted with the value.
+    /// @throw  std::runtime_error if the map is full.
+    bool insert(const key_type& key, const mapped_type& value)
+    {
+        bool inserted = false;
+        slot_type* p_slot = acquire_slot(key, inserted);
+        if (inserted) {
+            uint64_t expected = 0;
+            inserted = p_slot->value.compare_exchange_strong(expected, to_word(value), std::memory_order_acq_rel);
+        }
+        return inserted;
+    }
+
+    /// @brief  Insert the key or replace its value.
+    /// @return true if the key was inserted.
+    /// @throw  std::runtime_error if the map is full.
+    bool insert_or_assign(const key_type& key, const mapped_type& value)
+    {
+        bool inserted = false;
+        slot_type* p_slot = acquire_slot(key, inserted);
+        p_slot->value.store(to_word(value), std::memory_order_release);
+        return inserted;
+    }
+
+    /// @brief  Ratio of the keys to the slots.
+    double load_factor() const { return (capacity() != 0) ? double(size()) / capacity() : 0.0; }
+
+    /// @brief  Number of the keys, it includes the keys inserted concurrently.
+    size_type size() const { return m_p_header ? m_p_header->count.load(std::memory_order_relaxed) : 0; }
+
+    void swap(mmap_concurrent_hash_map& orig)
+    {
+        m_buffer.swap(orig.m_buffer);
+        std::swap(m_p_header, orig.m_p_header);
+        std::swap(m_p_slots, orig.m_p_slots);
+        std::swap(m_mask, orig.m_mask);
+    }
+
+    /// @brief  Write the map to the storage.
+    /// @throw  std::runtime_error if can not synchronize the file.
+    void sync() const
+    {
+        m_buffer.flush(0, m_buffer.whole_size, false);
+        m_buffer.sync();
+    }
+
+    mmap_concurrent_hash_map& operator=(const mmap_concurrent_hash_map& orig) = delete;
+
+    mmap_concurrent_hash_map& operator=(mmap_concurrent_hash_map&& orig)
+    {
+        if (this != &orig) {
+            mmap_concurrent_hash_map(std::move(orig)).swap(*this);
+        }
+        return *this;
+    }
+
+private:
+    template<typename TTp>
+    static uint64_t to_word(const TTp& val)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, &val, sizeof(val));
+        return word;
+    }
+
+    template<typename TTp>
+    static TTp from_word(uint64_t word)
+    {
+        TTp val;
+        std::memcpy(&val, &word, sizeof(val));
+        return val;
+    }
+
+    /// @brief  Find the slot of the key or take the empty slot for it.
+    /// @param  key      - key.
+    /// @param  inserted - true if the key took the empty slot.
+    /// @throw  std::runtime_error if the key is reserved or the map is full.
+    slot_type* acquire_slot(const key_type& key, bool& inserted)
+    {
+        assert(m_p_header != nullptr);
+
+        const uint64_t key_word = ~to_word(key);
+        if (key_word == 0) {
+            throw std::runtime_error("mmap_concurrent_hash_map: the key of all one bits is reserved");
+        }
+
+        size_t i = hasher()(key, m_p_header->seed) & m_mask;
+        for (size_t probe = 0; probe <= m_mask; ++probe, i = (i + 1) & m_mask) {
+            slot_type& slot = m_p_slots[i];
+            uint64_t cur = slot.key.load(std::memory_order_acquire);
+            if (cur == 0 && slot.key.compare_exchange_strong(cur, key_word, std::memory_order_acq_rel)) {
+                m_p_header->count.fetch_add(1, std::memory_order_relaxed);
+                inserted = true;
+                return &slot;
+            }
+            // The slot is taken by this key or by another one, possibly just now.
+            if (cur == key_word) {
+                inserted = false;
+                return &slot;
+            }
+        }
+        throw std::runtime_error("mmap_concurrent_hash_map: the map is full, rehash it to the larger capacity");
+    }
+
+    /// @brief  Find the slot of the key, nullptr if there is no such key.
+    slot_type* find_slot(const key_type& key) const
+    {
+        if (m_p_header == nullptr) {
+            return nullptr;
+        }
+
+        const uint64_t key_word = ~to_word(key);
+        size_t i = hasher()(key, m_p_header->seed) & m_mask;
+        for (size_t probe = 0; probe <= m_mask; ++probe, i = (i + 1) & m_mask) {
+            const uint64_t cur = m_p_slots[i].key.load(std::memory_order_acquire);
+            if (cur == key_word) {
+                return &m_p_slots[i];
+            }
+            if (cur == 0) {
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    _mapper m_buffer;
+
+    header_type* m_p_header;
+    slot_type* m_p_slots;
+    size_t m_mask;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_CONCURRENT_HASH_MAP_H */
@@ -30,11 +30,12 @@
 #include "mfcnt/details/mmap_deque_iterator.h"
 
 namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
 
 template<typename TTp, size_t TCount = 4*1024*1024>
-class mmap_deque_view : protected details::mmap_base_container<TTp, sizeof(TTp)*TCount, details::mmap_deque_iterator>
+class mmap_deque_view : protected details::mmap_base_container<TTp, details::utils::window_geometry<TTp, TCount>::count, details::mmap_deque_iterator>
 {
-    typedef details::mmap_base_container<TTp, sizeof(TTp)*TCount, details::mmap_deque_iterator> base;
+    typedef details::mmap_base_container<TTp, details::utils::window_geometry<TTp, TCount>::count, details::mmap_deque_iterator> base;
 
 public:
     typedef TTp                                     value_type;
@@ -46,6 +47,8 @@ public:
     typedef typename base::const_iterator           const_iterator;
     typedef std::reverse_iterator<iterator>         reverse_iterator;
     typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+    typedef typename base::segment_range            segment_range;
+    typedef typename base::contiguous_range         contiguous_range;
     typedef size_t                                  size_type;
     typedef ptrdiff_t                               difference_type;
 
@@ -53,20 +56,28 @@ public:
         : base()
     {}
 
-    mmap_deque_view(const char* file_path, size_t size, off64_t offset, mode m = mode::R_ONLY)
-        : base(file_path, size, offset, m)
+    mmap_deque_view(const char* file_path, size_t size, off64_t offset, mode m = mode::R_ONLY,
+                    map_policy policy = map_policy::SEGMENTED, advice adv = advice::NORMAL,
+                    page_policy pages = page_policy::BASE_PAGES)
+        : base(file_path, size, offset, m, policy, adv, pages)
     {}
 
-    mmap_deque_view(const std::string& file_path, size_t size, off64_t offset, mode m = mode::R_ONLY)
-        : base(file_path, size, offset, m)
+    mmap_deque_view(const std::string& file_path, size_t size, off64_t offset, mode m = mode::R_ONLY,
+                    map_policy policy = map_policy::SEGMENTED, advice adv = advice::NORMAL,
+                    page_policy pages = page_policy::BASE_PAGES)
+        : base(file_path, size, offset, m, policy, adv, pages)
     {}
 
-    mmap_deque_view(const char* file_path, off64_t offset = 0, mode m = mode::R_ONLY)
-        : base(std::string(file_path), offset, m)
+    mmap_deque_view(const char* file_path, off64_t offset = 0, mode m = mode::R_ONLY,
+                    map_policy policy = map_policy::SEGMENTED, advice adv = advice::NORMAL,
+                    page_policy pages = page_policy::BASE_PAGES)
+        : base(std::string(file_path), offset, m, policy, adv, pages)
     {}
 
-    mmap_deque_view(const std::string& file_path, off64_t offset = 0, mode m = mode::R_ONLY)
-        : base(file_path, offset, m)
+    mmap_deque_view(const std::string& file_path, off64_t offset = 0, mode m = mode::R_ONLY,
+                    map_policy policy = map_policy::SEGMENTED, advice adv = advice::NORMAL,
+                    page_policy pages = page_policy::BASE_PAGES)
+        : base(file_path, offset, m, policy, adv, pages)
     {}
 
     mmap_deque_view(const mmap_deque_view& orig)
@@ -79,6 +90,14 @@ public:
 
     virtual ~mmap_deque_view() {}
 
+    /// @brief  Set the access pattern hint for the container.
+    /// @details    The hint is passed to the kernel for the file and for each
+    ///             window mapped by the container or by its iterators.
+    void advise(advice adv) { base::advise(adv); }
+
+    /// @brief  Set the access pattern hint for the elements [pos, pos + count).
+    void advise(advice adv, size_type pos, size_type count) { base::advise(adv, pos, count); }
+
     const_reference at(size_type pos) const
     {
         base::check_range(pos);
@@ -87,24 +106,93 @@ public:
 
     const_reference back() const { return (*this)[size() - 1]; }
 
-    iterator begin() { return iterator(base::m_buffer, 0, 0); }
+    iterator begin() { return base::template make_iterator<iterator>(0); }
+
+    const_iterator begin() const { return base::template make_iterator<const_iterator>(0); }
+
+    const_iterator cbegin() const { return base::template make_iterator<const_iterator>(0); }
+
+    const_iterator cend() const { return base::template make_iterator<const_iterator>(base::m_size); }
+
+    /// @brief  Pointer iterators over the contiguous storage of the elements.
+    /// @details    The range is the fast path of the algorithms over the
+    ///             container: its iterators are const_pointer.
+    /// @return All elements if the whole range is mapped, i.e. the container was
+    ///         created with map_policy::WHOLE_FILE or with map_policy::CONCURRENT
+    ///         over the large range, the empty range otherwise.
+    contiguous_range contiguous() const { return base::make_contiguous(); }
+
+    /// @brief  Pointer to the contiguous storage of the elements.
+    /// @return Pointer to the first element if the whole range is mapped, nullptr otherwise.
+    const_pointer data() const { return base::data(); }
+
+    /// @brief  Read the pages of the container into memory, so the following
+    ///         accesses do not wait for the disk.
+    /// @details    With map_policy::WHOLE_FILE and map_policy::CONCURRENT the
+    ///             pages stay mapped until the container is closed. With
+    ///             map_policy::SEGMENTED the page cache is filled through the
+    ///             temporary mappings, the windows still map the pages on the
+    ///             first access without reading the file; the locked pages are
+    ///             kept mapped until the container is closed.
+    /// @param  policy       - how the pages are read.
+    /// @param  thread_count - number of threads of load_policy::PREFAULT,
+    ///                        0 is the number of the hardware threads.
+    /// @param  lock         - lock the pages in memory with mlock.
+    /// @throw  std::runtime_error if can not map or lock the pages.
+    void eager_load(load_policy policy = load_policy::PREFAULT, size_type thread_count = 0, bool lock = false) const
+    {
+        base::eager_load(policy, thread_count, lock);
+    }
 
-    const_iterator begin() const { return const_iterator(base::m_buffer, 0, 0); }
+    bool empty() const { return (size() == 0); }
 
-    const_iterator cbegin() const { return const_iterator(base::m_buffer, 0, 0); }
+    iterator end() { return base::template make_iterator<iterator>(base::m_size); }
 
-    const_iterator cend() const { return const_iterator(base::m_buffer, base::m_size / (sizeof(TTp)*TCount), base::m_size); }
+    const_iterator end() const { return base::template make_iterator<const_iterator>(base::m_size); }
 
-    bool empty() const { return (size() == 0); }
+    /// @brief  Reset the counters of the mapping activity.
+    void reset_stats() { base::reset_stats(); }
 
-    iterator end() { return iterator(base::m_buffer, base::m_size / (sizeof(TTp)*TCount), base::m_size); }
+    /// @brief  Range of the contiguous spans of the elements, one per window.
+    /// @details    Each span is valid until its window is evicted, so the span
+    ///             must be processed before dereferencing the next one.
+    segment_range segments() const { return base::make_segments(0, size()); }
 
-    const_iterator end() const { return const_iterator(base::m_buffer, base::m_size / (sizeof(TTp)*TCount), base::m_size); }
+    /// @brief  Range of the contiguous spans of the elements [pos, pos + count).
+    segment_range segments(size_type pos, size_type count) const { return base::make_segments(pos, count); }
+
+    /// @brief  Set the read-ahead of the next window during the sequential iteration.
+    /// @details    When an iterator passes the fraction of the current window,
+    ///             the kernel is asked to read the next window ahead, so the page
+    ///             faults in the next window do not wait for the disk.
+    /// @param  fraction - fraction of the window in the range [0, 1], 0 disables the read-ahead.
+    void set_prefetch(double fraction) { base::set_prefetch(fraction); }
+
+    /// @brief  Set the number of windows of the file kept mapped at the same time.
+    /// @details    Random access that alternates between several regions of the
+    ///             file does not remap the window on each access while the number
+    ///             of regions does not exceed the number of windows.
+    void set_window_count(size_type count) { base::set_window_count(count); }
 
     size_type size() const { return base::m_size; }
 
+    /// @brief  Counters of the mapping activity since the container was
+    ///         created or the counters were reset.
+    /// @details    The counters are collected only if MFCNT_STATS is defined
+    ///             before the headers are included, otherwise they are zero.
+    ///             The hit ratio and the number of the remaps show whether
+    ///             TCount and the number of windows suit the access pattern.
+    mfcnt::stats stats() const { return base::stats(); }
+
     void swap(mmap_deque_view& orig) { base::swap(orig); }
 
+    size_type window_count() const { return base::window_count(); }
+
+    /// @brief  Position of the first element of the window which contains the element.
+    /// @details    Ranges split at these positions consist of whole windows, so
+    ///             the ranges can be processed by different copies of the container.
+    size_type window_first(size_type pos) const { return base::window_first(pos); }
+
     mmap_deque_view& operator=(const mmap_deque_view& orig)
     {
         if (this != &orig) {
@@ -128,6 +216,7 @@ public:
     }
 };
 
+MFCNT_INLINE_NAMESPACE_END
 } // namespace mfcnt
 
 #endif /* _MMAP_CONTAINERS_MFCNT_MMAP_DEQUE_VIEW_H */
@@ -0,0 +1,284 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_LINE_INDEX_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_LINE_INDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mfcnt/types.h"
+#include "mfcnt/algorithm.h"
+#include "mfcnt/mmap_deque_view.h"
+#include "mfcnt/mmap_list_view.h"
+#include "mfcnt/mmap_vector.h"
+#include "mfcnt/details/hash.h"
+#include "mfcnt/details/simd.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+
+/// @brief  Index of the lines of the text file for the random access to the lines.
+/// @details    The text is scanned once for the newlines by several threads and
+///             the offsets of the lines are stored in the side file, which is
+///             mapped as mmap_list_view<uint64_t>. The side file starts with
+///             the header: the magic, the size of the indexed part of the text,
+///             the number of the newlines in it and the checksum of the header,
+///             followed by the offsets past each newline.
+/// @note   The text file is expected to be only appended to: update() indexes
+///         the appended data and rebuilds the index only if the file became
+///         smaller than its indexed part.
+class mmap_line_index
+{
+    typedef mmap_deque_view<char>       text_view;
+    typedef mmap_list_view<uint64_t>    offsets_view;
+
+    /// Positions of the fields of the header in the side file.
+    enum header_field
+    {
+        MAGIC,          // Magic of the side file.
+        INDEXED_SIZE,   // Size of the indexed part of the text in bytes.
+        NEWLINES,       // Number of the newlines in the indexed part.
+        CHECKSUM,       // Checksum of the fields above.
+        HEADER_SIZE     // Number of the fields.
+    };
+
+    /// "MFCNTLIX" in the little-endian byte order.
+    static constexpr uint64_t s_magic = 0x58494c544e43464dULL;
+
+public:
+    typedef size_t                              size_type;
+    typedef details::mmap_segment<const char>   line_type;
+
+    mmap_line_index()
+        : m_indexed_size(0)
+        , m_newlines(0)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  file_path    - path to the text file.
+    /// @param  thread_count - number of the threads of the scan, 0 is the number
+    ///                        of the hardware threads.
+    /// @throw  std::runtime_error if can not open, map or write the files.
+    explicit mmap_line_index(const std::string& file_path, size_type thread_count = 0)
+        : mmap_line_index(file_path, file_path + ".lidx", thread_count)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  file_path    - path to the text file.
+    /// @param  index_path   - path to the side file, it is created or updated.
+    /// @param  thread_count - number of the threads of the scan, 0 is the number
+    ///                        of the hardware threads.
+    /// @throw  std::runtime_error if can not open, map or write the files.
+    mmap_line_index(const std::string& file_path, const std::string& index_path, size_type thread_count = 0)
+        : m_file_path(file_path)
+        , m_index_path(index_path)
+        , m_indexed_size(0)
+        , m_newlines(0)
+    {
+        update(thread_count);
+    }
+
+    bool empty() const { return (size() == 0); }
+
+    const std::string& file_path() const { return m_file_path; }
+
+    const std::string& index_path() const { return m_index_path; }
+
+    /// @brief  Size of the indexed part of the text in bytes.
+    size_type indexed_size() const { return m_indexed_size; }
+
+    /// @brief  Characters of the line without the newline.
+    /// @details    The whole text is mapped, so the line is contiguous even if it
+    ///             crosses the windows of the text, pos of the span is the offset
+    ///             of the line in the file. The span is valid until update().
+    /// @param  k - number of the line.
+    line_type line(size_type k) const
+    {
+        assert(k < size());
+
+        const size_t first = (k != 0) ? m_offsets[k - 1] : 0;
+        const size_t last = (k < m_newlines) ? m_offsets[k] - 1 : m_indexed_size;
+
+        line_type res;
+        res.first = m_text.data() + first;
+        res.last = m_text.data() + last;
+        res.pos = first;
+        return res;
+    }
+
+    /// @brief  Number of the lines, the characters after the last newline are a line too.
+    size_type size() const
+    {
+        const size_t last_first = (m_newlines != 0) ? m_offsets[m_newlines - 1] : 0;
+        return m_newlines + ((m_indexed_size > last_first) ? 1 : 0);
+    }
+
+    /// @brief  Index the data appended to the text file since the last update.
+    /// @details    The side file of the unchanged text is not written. Otherwise
+    ///             the side file is checked first: the offsets of an interrupted
+    ///             update are dropped, and the index is rebuilt if the side file
+    ///             is not an index or the text file became smaller than its
+    ///             indexed part.
+    /// @param  thread_count - number of the threads of the scan, 0 is the number
+    ///                        of the hardware threads.
+    /// @throw  std::runtime_error if can not open, map or write the files.
+    void update(size_type thread_count = 0)
+    {
+        // The files are mapped again with the new sizes.
+        m_offsets = offsets_view();
+        m_text = text_view();
+
+        text_view text(m_file_path, 0, mode::R_ONLY, map_policy::WHOLE_FILE);
+        if (! text.empty() && ! text.data()) {
+            throw std::runtime_error("mmap_line_index: error map the whole file '" + m_file_path + "' to memory");
+        }
+
+        uint64_t header[HEADER_SIZE] = {};
+        if (! read_header(header) || header[INDEXED_SIZE] != text.size()) {
+            mmap_vector<uint64_t> index(m_index_path);
+            if (index.size() >= HEADER_SIZE) {
+                std::copy(index.cbegin(), index.cbegin() + HEADER_SIZE, header);
+            }
+            const bool valid = index.size() >= HEADER_SIZE && valid_header(header)
+                               && header[INDEXED_SIZE] <= text.size()
+                               && header[NEWLINES] <= index.size() - HEADER_SIZE;
+            if (valid) {
+                index.resize(HEADER_SIZE + header[NEWLINES]);
+            } else {
+                index.clear();
+                index.resize(HEADER_SIZE, 0);
+                std::fill(header, header + HEADER_SIZE, 0);
+                header[MAGIC] = s_magic;
+            }
+
+            const size_t indexed_size = header[INDEXED_SIZE];
+            if (text.size() > indexed_size) {
+                const text_view tail(m_file_path, text.size() - indexed_size, indexed_size);
+                for (const std::vector<uint64_t>& part : scan(tail, indexed_size, thread_count)) {
+                    for (const uint64_t offset : part) {
+                        index.push_back(offset);
+                    }
+                }
+                header[INDEXED_SIZE] = text.size();
+                header[NEWLINES] = index.size() - HEADER_SIZE;
+            }
+
+            // The offsets reach the storage before the header which covers them
+            // and the checksum rejects the torn header, so an interrupted update
+            // keeps the old index or rebuilds it.
+            index.sync();
+            header[CHECKSUM] = header_checksum(header);
+            for (size_t i = 0; i < HEADER_SIZE; ++i) {
+                index[i] = header[i];
+            }
+            index.sync();
+            index.close();
+        }
+        m_indexed_size = header[INDEXED_SIZE];
+        m_newlines = header[NEWLINES];
+
+        m_offsets = offsets_view(m_index_path, HEADER_SIZE * sizeof(uint64_t), mode::R_ONLY, map_policy::CONCURRENT);
+        m_text = std::move(text);
+    }
+
+private:
+    /// @brief  Read the header of the side file.
+    /// @param  header - the fields of the header.
+    /// @return true if the side file is the complete index.
+    bool read_header(uint64_t (&header)[HEADER_SIZE]) const
+    {
+        std::ifstream fin(m_index_path, std::ios::binary | std::ios::ate);
+        if (! fin) {
+            return false;
+        }
+        const std::streamoff file_size = fin.tellg();
+        fin.seekg(0);
+        if (! fin.read(reinterpret_cast<char*>(header), sizeof(header)) || ! valid_header(header)) {
+            return false;
+        }
+        return uint64_t(file_size) == (HEADER_SIZE + header[NEWLINES]) * sizeof(uint64_t);
+    }
+
+    /// @brief  Checksum of the fields of the header before CHECKSUM.
+    static uint64_t header_checksum(const uint64_t (&header)[HEADER_SIZE])
+    {
+        return details::hash_bytes(header, CHECKSUM * sizeof(uint64_t), s_magic);
+    }
+
+    static bool valid_header(const uint64_t (&header)[HEADER_SIZE])
+    {
+        return header[MAGIC] == s_magic && header[CHECKSUM] == header_checksum(header);
+    }
+
+    /// @brief  Find the newlines of the range of the text in several threads.
+    /// @param  tail         - view of the range.
+    /// @param  offset       - offset of the range in the file.
+    /// @param  thread_count - number of the threads.
+    /// @return Offsets past the newlines in the file, one vector per range of the partition.
+    static std::vector<std::vector<uint64_t>> scan(const text_view& tail, size_t offset, size_type thread_count)
+    {
+        const std::vector<size_t> bounds = details::window_partition(tail, details::parallel_thread_count(thread_count));
+        std::vector<std::vector<uint64_t>> parts(bounds.size() - 1);
+        if (parts.empty()) {
+            return parts;
+        }
+
+        details::run_partition(tail, bounds, [&parts, offset](const text_view& part, size_t part_num,
+                                                              size_t first, size_t last) {
+            std::vector<uint64_t>& offsets = parts[part_num];
+            for (const text_view::segment_range::value_type& seg : part.segments(first, last - first)) {
+                const char* p_newline = seg.begin();
+                while ((p_newline = details::simd::find(p_newline, seg.end(), '\n')) != seg.end()) {
+                    ++p_newline;
+                    offsets.push_back(offset + seg.pos + (p_newline - seg.begin()));
+                }
+            }
+        });
+        return parts;
+    }
+
+    std::string m_file_path;
+    std::string m_index_path;
+
+    /// Whole mapping of the indexed part of the text.
+    text_view m_text;
+
+    /// Offsets past the newlines.
+    offsets_view m_offsets;
+
+    size_t m_indexed_size;
+    size_t m_newlines;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_LINE_INDEX_H */
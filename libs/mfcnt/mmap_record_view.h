@@ -0,0 +1,275 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_RECORD_VIEW_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_RECORD_VIEW_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "mfcnt/types.h"
+#include "mfcnt/mmap_deque_view.h"
+#include "mfcnt/details/mmap_record_iterator.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+
+template<typename TLen, size_t TCount>
+class mmap_record_view;
+
+template<size_t TCount>
+class mmap_log_view;
+
+/// @brief  Payload of the length-prefixed record.
+/// @details    The payload that lies in one window of the file points to the
+///             mapping, the payload that crosses the windows is copied.
+class mmap_record
+{
+    template<typename TLen, size_t TCount>
+    friend class mmap_record_view;
+
+    template<size_t TCount>
+    friend class mmap_log_view;
+
+public:
+    typedef char            value_type;
+    typedef const char*     const_pointer;
+    typedef const char*     const_iterator;
+    typedef size_t          size_type;
+
+    mmap_record()
+        : m_p_first(NULL)
+        , m_size(0)
+        , m_pos(0)
+    {}
+
+    const_iterator begin() const { return data(); }
+
+    /// @brief  Whether the payload is a copy of the mapping.
+    bool copied() const { return (m_p_first == NULL && m_size != 0); }
+
+    const_pointer data() const { return (m_p_first != NULL) ? m_p_first : m_copy.data(); }
+
+    bool empty() const { return (m_size == 0); }
+
+    const_iterator end() const { return data() + m_size; }
+
+    /// @brief  Offset of the payload in the view.
+    size_type pos() const { return m_pos; }
+
+    size_type size() const { return m_size; }
+
+private:
+    const char* m_p_first;
+    size_t m_size;
+    size_t m_pos;
+    std::string m_copy;
+};
+
+/// @brief  Read only view of the file of the length-prefixed records.
+/// @details    Each record is the length of the payload of the TLen type in the
+///             native byte order followed by the payload. The records are read
+///             in place: the payload points to the mapping unless it crosses the
+///             windows of the file. Without the index the records are accessed
+///             by the iterators or by the offsets, build_index() stores the
+///             offsets of all records for operator[].
+/// @note   The payload that points to the mapping is valid until the next
+///         record is read, because the window of the record can be evicted.
+/// @tparam TLen   - unsigned integral type of the length prefix.
+/// @tparam TCount - number of the bytes in the window.
+template<typename TLen = uint32_t, size_t TCount = 4*1024*1024>
+class mmap_record_view
+{
+    static_assert(std::is_integral<TLen>::value && std::is_unsigned<TLen>::value,
+                  "the length prefix should be of the unsigned integral type");
+
+    typedef mmap_deque_view<char, TCount>   data_view;
+
+public:
+    typedef mmap_record                                 record_type;
+    typedef mmap_record                                 value_type;
+    typedef details::mmap_record_iterator<mmap_record_view> const_iterator;
+    typedef size_t                                      size_type;
+
+    mmap_record_view()
+        : m_indexed(false)
+    {}
+
+    mmap_record_view(const std::string& file_path, size_t size, off64_t offset,
+                     map_policy policy = map_policy::SEGMENTED, advice adv = advice::NORMAL)
+        : m_data(file_path, size, offset, mode::R_ONLY, policy, adv)
+        , m_indexed(false)
+    {}
+
+    mmap_record_view(const std::string& file_path, off64_t offset = 0,
+                     map_policy policy = map_policy::SEGMENTED, advice adv = advice::NORMAL)
+        : m_data(file_path, offset, mode::R_ONLY, policy, adv)
+        , m_indexed(false)
+    {}
+
+    /// @throw  std::out_of_range if the view is not indexed or pos is out of range.
+    record_type at(size_type pos) const
+    {
+        if (! m_indexed || pos >= size()) {
+            throw std::out_of_range("mmap_record_view: position is out of range");
+        }
+        return (*this)[pos];
+    }
+
+    const_iterator begin() const { return const_iterator(*this, 0); }
+
+    /// @brief  Store the offsets of all records, so the records are accessed by the number.
+    /// @details    Only the length prefixes are read, the payloads are skipped.
+    /// @throw  std::runtime_error if the last record is truncated.
+    void build_index()
+    {
+        std::vector<uint64_t> offsets;
+        for (size_t offset = 0; offset < bytes(); offset = next(offset)) {
+            offsets.push_back(offset);
+        }
+        m_offsets.swap(offsets);
+        m_indexed = true;
+    }
+
+    /// @brief  Size of the view in bytes.
+    size_type bytes() const { return m_data.size(); }
+
+    const_iterator cbegin() const { return const_iterator(*this, 0); }
+
+    const_iterator cend() const { return const_iterator(*this, bytes()); }
+
+    bool empty() const { return (bytes() == 0); }
+
+    const_iterator end() const { return const_iterator(*this, bytes()); }
+
+    bool indexed() const { return m_indexed; }
+
+    /// @brief  Offset of the record in the view.
+    /// @param  pos - number of the record, the view should be indexed.
+    size_type offset(size_type pos) const
+    {
+        assert(m_indexed && pos < size());
+        return m_offsets[pos];
+    }
+
+    /// @brief  Read the record.
+    /// @param  offset - offset of the length prefix of the record in the view.
+    /// @throw  std::runtime_error if the record is truncated.
+    record_type read(size_type offset) const
+    {
+        record_type res;
+        res.m_pos = offset + sizeof(TLen);
+        res.m_size = read_length(offset);
+        if (res.m_size == 0) {
+            return res;
+        }
+
+        if (m_data.window_first(res.m_pos) == m_data.window_first(res.m_pos + res.m_size - 1)) {
+            res.m_p_first = &m_data[res.m_pos];
+        } else {
+            res.m_copy.resize(res.m_size);
+            copy(res.m_pos, res.m_size, &res.m_copy[0]);
+        }
+        return res;
+    }
+
+    /// @brief  Reset the counters of the mapping activity.
+    void reset_stats() { m_data.reset_stats(); }
+
+    /// @brief  Set the number of windows of the file kept mapped at the same time.
+    void set_window_count(size_type count) { m_data.set_window_count(count); }
+
+    /// @brief  Number of the records, the view should be indexed.
+    size_type size() const
+    {
+        assert(m_indexed);
+        return m_offsets.size();
+    }
+
+    /// @brief  Counters of the mapping activity of the view.
+    mfcnt::stats stats() const { return m_data.stats(); }
+
+    void swap(mmap_record_view& orig)
+    {
+        m_data.swap(orig.m_data);
+        m_offsets.swap(orig.m_offsets);
+        std::swap(m_indexed, orig.m_indexed);
+    }
+
+    record_type operator[](size_type pos) const { return read(offset(pos)); }
+
+private:
+    /// @brief  Copy the bytes of the view that can cross the windows.
+    void copy(size_t pos, size_t count, char* p_out) const
+    {
+        for (const typename data_view::segment_range::value_type& seg : m_data.segments(pos, count)) {
+            std::memcpy(p_out, seg.first, seg.size());
+            p_out += seg.size();
+        }
+    }
+
+    /// @brief  Offset of the record that follows the record.
+    size_t next(size_t offset) const { return offset + sizeof(TLen) + read_length(offset); }
+
+    /// @brief  Read the length prefix of the record and check the record fits the view.
+    size_t read_length(size_t offset) const
+    {
+        assert(offset < bytes());
+
+        if (bytes() - offset < sizeof(TLen)) {
+            throw std::runtime_error("mmap_record_view: truncated length of the record at offset "
+                                     + std::to_string(offset));
+        }
+
+        TLen length = 0;
+        if (m_data.window_first(offset) == m_data.window_first(offset + sizeof(TLen) - 1)) {
+            std::memcpy(&length, &m_data[offset], sizeof(TLen));
+        } else {
+            copy(offset, sizeof(TLen), reinterpret_cast<char*>(&length));
+        }
+
+        if (bytes() - offset - sizeof(TLen) < length) {
+            throw std::runtime_error("mmap_record_view: truncated record at offset " + std::to_string(offset));
+        }
+        return length;
+    }
+
+    data_view m_data;
+
+    /// Offsets of the records if the view is indexed.
+    std::vector<uint64_t> m_offsets;
+
+    bool m_indexed;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_RECORD_VIEW_H */
@@ -0,0 +1,231 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_SORTED_VIEW_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_SORTED_VIEW_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mfcnt/types.h"
+#include "mfcnt/mmap_deque_view.h"
+#include "mfcnt/details/utils.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+
+/// @brief  Read only view of the file of the sorted keys with the fast search.
+/// @details    The view keeps the fence index in memory: the first key of each
+///             block of the keys, by default the block is a memory page. The
+///             search finds the block in the fences and then touches the keys
+///             of one block only, while std::lower_bound over the container
+///             maps a new window for almost every probe.
+/// @note   The fences are read when the view is created, so each block of the
+///         file is touched once. The larger blocks make the fence index and
+///         its creation cheaper, the search then touches several pages of the
+///         block.
+/// @tparam TKey     - type of the keys, the keys are sorted by TCompare in the file.
+/// @tparam TCompare - comparator of the keys.
+/// @tparam TCount   - number of the keys in the window.
+template<typename TKey, typename TCompare = std::less<TKey>, size_t TCount = 4*1024*1024>
+class mmap_sorted_view
+{
+    typedef mmap_deque_view<TKey, TCount>   data_view;
+
+public:
+    typedef TKey                                        key_type;
+    typedef TKey                                        value_type;
+    typedef TCompare                                    key_compare;
+    typedef typename data_view::const_reference         const_reference;
+    typedef typename data_view::const_iterator          const_iterator;
+    typedef size_t                                      size_type;
+
+    mmap_sorted_view()
+        : m_block(1)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  file_path - path to the file of the sorted keys.
+    /// @param  offset    - offset of the first key in the file.
+    /// @throw  std::runtime_error if can not open or map the file.
+    explicit mmap_sorted_view(const std::string& file_path, off64_t offset = 0)
+        : m_data(file_path, offset)
+        , m_block(block_size(0))
+    {
+        build_fences();
+    }
+
+    /// @brief  Constructor.
+    /// @param  file_path - path to the file of the sorted keys.
+    /// @param  size      - size of the keys in bytes.
+    /// @param  offset    - offset of the first key in the file.
+    /// @param  block     - number of the keys per fence, 0 is the keys of the memory page.
+    /// @param  comp      - comparator of the keys.
+    /// @throw  std::runtime_error if can not open or map the file.
+    mmap_sorted_view(const std::string& file_path, size_t size, off64_t offset, size_type block = 0,
+                     const key_compare& comp = key_compare())
+        : m_data(file_path, size, offset)
+        , m_block(block_size(block))
+        , m_comp(comp)
+    {
+        build_fences();
+    }
+
+    const_reference at(size_type pos) const { return m_data.at(pos); }
+
+    const_reference back() const { return m_data.back(); }
+
+    /// @brief  Number of the keys per fence.
+    size_type block() const { return m_block; }
+
+    const_iterator cbegin() const { return m_data.cbegin(); }
+
+    const_iterator cend() const { return m_data.cend(); }
+
+    bool contains(const key_type& key) const { return (find(key) != size()); }
+
+    bool empty() const { return m_data.empty(); }
+
+    /// @brief  Positions of the range of the keys equivalent to the key.
+    std::pair<size_type, size_type> equal_range(const key_type& key) const
+    {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    /// @brief  Position of the key equivalent to the key, size() if there is no such key.
+    size_type find(const key_type& key) const
+    {
+        const size_type pos = lower_bound(key);
+        return (pos != size() && ! m_comp(key, m_data[pos])) ? pos : size();
+    }
+
+    /// @brief  Position of the first key that is not less than the key, size() if there is no such key.
+    size_type lower_bound(const key_type& key) const
+    {
+        const TCompare& comp = m_comp;
+        const size_type fence = std::lower_bound(m_fences.begin(), m_fences.end(), key, comp) - m_fences.begin();
+        return search_block(fence, [&key, &comp](const key_type* p_first, const key_type* p_last) {
+            return std::lower_bound(p_first, p_last, key, comp);
+        });
+    }
+
+    /// @brief  Reset the counters of the mapping activity.
+    void reset_stats() { m_data.reset_stats(); }
+
+    /// @brief  Set the number of windows of the file kept mapped at the same time.
+    void set_window_count(size_type count) { m_data.set_window_count(count); }
+
+    size_type size() const { return m_data.size(); }
+
+    /// @brief  Counters of the mapping activity of the view.
+    mfcnt::stats stats() const { return m_data.stats(); }
+
+    void swap(mmap_sorted_view& orig)
+    {
+        m_data.swap(orig.m_data);
+        m_fences.swap(orig.m_fences);
+        std::swap(m_block, orig.m_block);
+        std::swap(m_comp, orig.m_comp);
+    }
+
+    /// @brief  Position of the first key that is greater than the key, size() if there is no such key.
+    size_type upper_bound(const key_type& key) const
+    {
+        const TCompare& comp = m_comp;
+        const size_type fence = std::upper_bound(m_fences.begin(), m_fences.end(), key, comp) - m_fences.begin();
+        return search_block(fence, [&key, &comp](const key_type* p_first, const key_type* p_last) {
+            return std::upper_bound(p_first, p_last, key, comp);
+        });
+    }
+
+    const_reference operator[](size_type pos) const { return m_data[pos]; }
+
+private:
+    static size_type block_size(size_type block)
+    {
+        if (block != 0) {
+            return block;
+        }
+        const size_t page_size = details::utils::memory_page_size();
+        return std::max<size_t>(1, page_size / sizeof(key_type));
+    }
+
+    void build_fences()
+    {
+        std::vector<key_type> fences;
+        fences.reserve((size() + m_block - 1) / m_block);
+        for (size_t pos = 0; pos < size(); pos += m_block) {
+            fences.push_back(m_data[pos]);
+        }
+        m_fences.swap(fences);
+    }
+
+    /// @brief  Search the block that precedes the fence.
+    /// @details    The fence is the first one that does not satisfy the search,
+    ///             so the result lies in the previous block or it is the first
+    ///             key of the fence.
+    /// @param  fence  - number of the fence.
+    /// @param  search - function object (p_first, p_last) that searches the keys of the block.
+    template<typename TSearch>
+    size_type search_block(size_type fence, const TSearch& search) const
+    {
+        if (fence == 0) {
+            return 0;
+        }
+
+        const size_t first = (fence - 1) * m_block;
+        const size_t last = std::min(first + m_block, size());
+        if (m_data.window_first(first) == m_data.window_first(last - 1)) {
+            const key_type* p_first = &m_data[first];
+            return first + (search(p_first, p_first + (last - first)) - p_first);
+        }
+
+        // The block crosses the windows if the offset of the view is not aligned with the block.
+        for (const typename data_view::segment_range::value_type& seg : m_data.segments(first, last - first)) {
+            const key_type* p_found = search(seg.first, seg.last);
+            if (p_found != seg.last) {
+                return seg.pos + (p_found - seg.first);
+            }
+        }
+        return last;
+    }
+
+    data_view m_data;
+
+    /// First keys of the blocks.
+    std::vector<key_type> m_fences;
+
+    size_t m_block;
+    key_compare m_comp;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_SORTED_VIEW_H */
@@ -0,0 +1,336 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_STATIC_HASH_MAP_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_STATIC_HASH_MAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "mfcnt/types.h"
+#include "mfcnt/mmap_deque_view.h"
+#include "mfcnt/mmap_vector.h"
+#include "mfcnt/details/hash.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+namespace details {
+
+/// @brief  Header of the file of the static hash map.
+struct static_hash_header
+{
+    uint64_t magic;
+    uint64_t slot_size;     // Size of the slot in bytes, it checks the types of the map.
+    uint64_t count;         // Number of the elements.
+    uint64_t capacity;      // Number of the slots, a power of two.
+    uint64_t seed;          // Seed of the hash.
+    uint64_t reserved[3];
+};
+
+/// @brief  Slot of the static hash map.
+/// @details    The tag is the hash of the key with the lowest bit set, so the
+///             zero tag marks the empty slot and most of the probes of the
+///             other keys are rejected without comparing the keys.
+template<typename TKey, typename TValue>
+struct static_hash_slot
+{
+    uint64_t tag;
+    TKey key;
+    TValue value;
+};
+
+} // namespace details
+
+/// @brief  Read only hash map stored in the file.
+/// @details    The file is built once by build() and then served from the
+///             mapping: opening the map does not read the file and the
+///             processes that open the same file share its page cache. The
+///             elements are stored in the slots of the open addressing table
+///             with the linear probing, the load factor of the table is at
+///             most 0.5 by default, so a lookup reads one or two slots which
+///             usually lie in one cache line.
+/// @note   The keys and the values are stored as the bytes, so they should be
+///         trivially copyable. The file is read with the native byte order.
+/// @note   The lookups do not modify the map if the whole file is mapped, so
+///         they can run in several threads.
+/// @tparam TKey   - type of the keys.
+/// @tparam TValue - type of the values.
+/// @tparam THash  - function object (key, seed) of the hash that does not depend on the process.
+template<typename TKey, typename TValue, typename THash = details::mmap_hash<TKey>>
+class mmap_static_hash_map
+{
+    static_assert(std::is_trivially_copyable<TKey>::value, "the key should be trivially copyable");
+    static_assert(std::is_trivially_copyable<TValue>::value, "the value should be trivially copyable");
+
+    typedef details::static_hash_header                 header_type;
+    typedef details::static_hash_slot<TKey, TValue>     slot_type;
+    typedef mmap_deque_view<slot_type>                  slots_view;
+
+    /// "MFCNTSHM" in the little-endian byte order.
+    static constexpr uint64_t s_magic = 0x4d4853544e43464dULL;
+
+    static constexpr uint64_t s_seed = 0x2545f4914f6cdd1dULL;
+
+    /// Size of the header rounded up to the slot size, so the slots are the elements of the view.
+    static constexpr size_t s_header_size = (sizeof(header_type) + sizeof(slot_type) - 1)
+                                            / sizeof(slot_type) * sizeof(slot_type);
+
+public:
+    typedef TKey                                key_type;
+    typedef TValue                              mapped_type;
+    typedef THash                               hasher;
+    typedef size_t                              size_type;
+
+    mmap_static_hash_map()
+        : m_p_slots(NULL)
+        , m_count(0)
+        , m_mask(0)
+        , m_seed(0)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  file_path - path to the file created by build().
+    /// @param  policy    - policy of mapping the file, map_policy::WHOLE_FILE
+    ///                     serves the lookups by the pointer arithmetic.
+    /// @throw  std::runtime_error if can not open or map the file or the file
+    ///         is not the map of these types.
+    explicit mmap_static_hash_map(const std::string& file_path, map_policy policy = map_policy::WHOLE_FILE)
+        : m_p_slots(NULL)
+        , m_count(0)
+        , m_mask(0)
+        , m_seed(0)
+    {
+        const mmap_deque_view<char, 4096> bytes(file_path);
+        header_type header;
+        std::memset(&header, 0, sizeof(header));
+        if (bytes.size() >= s_header_size) {
+            std::copy_n(bytes.cbegin(), sizeof(header), reinterpret_cast<char*>(&header));
+        }
+        if (header.magic != s_magic || header.slot_size != sizeof(slot_type)) {
+            throw std::runtime_error("mmap_static_hash_map: file '" + file_path
+                                     + "' is not the hash map of these key and value types");
+        }
+        if (header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0
+            || header.count >= header.capacity
+            || bytes.size() != s_header_size + header.capacity * sizeof(slot_type)) {
+            throw std::runtime_error("mmap_static_hash_map: file '" + file_path + "' is corrupted");
+        }
+
+        slots_view slots(file_path, header.capacity * sizeof(slot_type), s_header_size, mode::R_ONLY, policy);
+        m_count = header.count;
+        m_mask = header.capacity - 1;
+        m_seed = header.seed;
+        m_slots.swap(slots);
+        m_p_slots = m_slots.data();
+    }
+
+    mmap_static_hash_map(const mmap_static_hash_map& orig)
+        : m_slots(orig.m_slots)
+        , m_p_slots(m_slots.data())
+        , m_count(orig.m_count)
+        , m_mask(orig.m_mask)
+        , m_seed(orig.m_seed)
+    {}
+
+    mmap_static_hash_map(mmap_static_hash_map&& orig)
+        : mmap_static_hash_map()
+    {
+        swap(orig);
+    }
+
+    /// @brief  Write the elements to the file of the map.
+    /// @details    The table is written to "<file_path>.tmp", which is synchronized
+    ///             and renamed over the file, so the maps opened earlier keep
+    ///             the old table and a crash leaves either the old or the new file.
+    /// @param  file_path - path to the file, the file is replaced.
+    /// @param  first     - iterator to the first pair of the key and the value.
+    /// @param  last      - iterator past the last pair.
+    /// @param  max_load  - maximum load factor of the table in the range (0, 1).
+    /// @throw  std::runtime_error if can not write the file or the keys are not unique.
+    template<typename TIt>
+    static void build(const std::string& file_path, TIt first, TIt last, double max_load = 0.5)
+    {
+        assert(max_load > 0.0 && max_load < 1.0);
+
+        const size_t count = std::distance(first, last);
+        size_t capacity = 2;
+        while (capacity * max_load < count) {
+            capacity *= 2;
+        }
+        const size_t mask = capacity - 1;
+
+        const std::string tmp_path = file_path + ".tmp";
+        mmap_vector<char> file(tmp_path);
+        try {
+            file.clear();
+            file.resize(s_header_size + capacity * sizeof(slot_type), 0);
+            char* p_slots = file.data() + s_header_size;
+
+            const hasher hash = hasher();
+            for (; first != last; ++first) {
+                const key_type& key = first->first;
+                const uint64_t h = hash(key, s_seed);
+                slot_type slot;
+                std::memset(&slot, 0, sizeof(slot));
+                slot.tag = h | 1;
+                slot.key = key;
+                slot.value = first->second;
+
+                for (size_t i = h & mask; ; i = (i + 1) & mask) {
+                    char* p_slot = p_slots + i * sizeof(slot_type);
+                    uint64_t tag = 0;
+                    std::memcpy(&tag, p_slot, sizeof(tag));
+                    if (tag == 0) {
+                        std::memcpy(p_slot, &slot, sizeof(slot));
+                        break;
+                    }
+                    if (tag == slot.tag
+                        && std::memcmp(p_slot + offsetof(slot_type, key), &slot.key, sizeof(key_type)) == 0) {
+                        throw std::runtime_error("mmap_static_hash_map: duplicate key in the elements of '"
+                                                 + file_path + "'");
+                    }
+                }
+            }
+
+            header_type header;
+            std::memset(&header, 0, sizeof(header));
+            header.magic = s_magic;
+            header.slot_size = sizeof(slot_type);
+            header.count = count;
+            header.capacity = capacity;
+            header.seed = s_seed;
+            std::memcpy(file.data(), &header, sizeof(header));
+            file.shrink_to_fit();
+            file.sync();
+            file.close();
+        } catch (...) {
+            std::remove(tmp_path.c_str());
+            throw;
+        }
+        if (std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+            throw std::runtime_error("mmap_static_hash_map: error rename '" + tmp_path + "' to '"
+                                     + file_path + "'");
+        }
+    }
+
+    /// @throw  std::out_of_range if there is no such key.
+    const mapped_type& at(const key_type& key) const
+    {
+        const mapped_type* p_value = find(key);
+        if (p_value == NULL) {
+            throw std::out_of_range("mmap_static_hash_map: key is not found");
+        }
+        return *p_value;
+    }
+
+    /// @brief  Number of the slots of the table.
+    size_type bucket_count() const { return m_slots.size(); }
+
+    bool contains(const key_type& key) const { return (find(key) != NULL); }
+
+    bool empty() const { return (m_count == 0); }
+
+    /// @brief  Find the value of the key in the mapping.
+    /// @return Pointer to the value in the mapping, NULL if there is no such key.
+    ///         The pointer is valid while the map is open if the whole file is
+    ///         mapped, otherwise until the next lookup.
+    const mapped_type* find(const key_type& key) const
+    {
+        if (m_count == 0) {
+            return NULL;
+        }
+
+        const uint64_t h = hasher()(key, m_seed);
+        const uint64_t tag = h | 1;
+        for (size_t i = h & m_mask; ; i = (i + 1) & m_mask) {
+            const slot_type& slot = (m_p_slots != NULL) ? m_p_slots[i] : m_slots[i];
+            if (slot.tag == 0) {
+                return NULL;
+            }
+            if (slot.tag == tag && std::memcmp(&slot.key, &key, sizeof(key_type)) == 0) {
+                return &slot.value;
+            }
+        }
+    }
+
+    /// @brief  Ratio of the elements to the slots.
+    double load_factor() const { return (m_count != 0) ? double(m_count) / bucket_count() : 0.0; }
+
+    /// @brief  Reset the counters of the mapping activity.
+    void reset_stats() { m_slots.reset_stats(); }
+
+    size_type size() const { return m_count; }
+
+    /// @brief  Counters of the mapping activity of the map.
+    mfcnt::stats stats() const { return m_slots.stats(); }
+
+    void swap(mmap_static_hash_map& orig)
+    {
+        m_slots.swap(orig.m_slots);
+        std::swap(m_p_slots, orig.m_p_slots);
+        std::swap(m_count, orig.m_count);
+        std::swap(m_mask, orig.m_mask);
+        std::swap(m_seed, orig.m_seed);
+    }
+
+    mmap_static_hash_map& operator=(const mmap_static_hash_map& orig)
+    {
+        if (this != &orig) {
+            mmap_static_hash_map(orig).swap(*this);
+        }
+        return *this;
+    }
+
+    mmap_static_hash_map& operator=(mmap_static_hash_map&& orig)
+    {
+        if (this != &orig) {
+            mmap_static_hash_map(std::move(orig)).swap(*this);
+        }
+        return *this;
+    }
+
+private:
+    slots_view m_slots;
+
+    /// Slots of the whole mapping, NULL if the file is mapped by the windows.
+    const slot_type* m_p_slots;
+
+    size_t m_count;
+    size_t m_mask;
+    uint64_t m_seed;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_STATIC_HASH_MAP_H */
@@ -0,0 +1,457 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Chistyakov Alexander.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MMAP_CONTAINERS_MFCNT_MMAP_VECTOR_H
+#define _MMAP_CONTAINERS_MFCNT_MMAP_VECTOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "mfcnt/types.h"
+#include "mfcnt/details/utils.h"
+
+namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
+
+/// @brief  Writable container of the elements stored in the file.
+/// @details    The whole file is mapped with mode::RW_SHARED, so the writes
+///             go to the page cache of the file without staging buffers.
+///             While the container is open the file is extended to the
+///             capacity, the size of the file is set to the size of the
+///             container when it is closed.
+/// @note   Like std::vector, growth of the capacity invalidates pointers,
+///         references and iterators.
+/// @note   Regions of the file modified through the mutable element access
+///         are tracked, so sync() writes only them. Writes through the
+///         pointers, e.g. data() or iterators, can not be tracked, so
+///         the mutable data(), begin() and end() mark the whole file.
+template<typename TTp>
+class mmap_vector
+{
+    static_assert(std::is_trivially_copyable<TTp>::value, "mmap_vector: element must be trivially copyable");
+
+    typedef details::utils::mmap_buffer<TTp*, details::utils::window_geometry<TTp, details::utils::kMinPageSize>::count> _mapper;
+
+    /// Shift of the offset in bytes to the number of the tracked region.
+    static constexpr size_t s_dirty_shift = details::utils::ilog2(details::utils::kChunkSize);
+
+public:
+    typedef TTp                                     value_type;
+    typedef value_type*                             pointer;
+    typedef const value_type*                       const_pointer;
+    typedef value_type&                             reference;
+    typedef const value_type&                       const_reference;
+    typedef pointer                                 iterator;
+    typedef const_pointer                           const_iterator;
+    typedef std::reverse_iterator<iterator>         reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+    typedef size_t                                  size_type;
+    typedef ptrdiff_t                               difference_type;
+
+    mmap_vector()
+        : m_size(0)
+        , m_capacity(0)
+        , m_all_dirty(false)
+    {}
+
+    /// @brief  Constructor.
+    /// @param  file_path - path to file, the file is created if it does not exist.
+    /// @throw  std::runtime_error if can not open or map the file or the size
+    ///         of the file is not a multiple of the element size.
+    explicit mmap_vector(const std::string& file_path)
+        : m_size(0)
+        , m_capacity(0)
+        , m_all_dirty(false)
+    {
+        m_buffer.open(file_path, O_CLOEXEC | O_LARGEFILE | O_RDWR | O_CREAT,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FILE);
+
+        const size_t file_size = m_buffer.file_size();
+        if (file_size % sizeof(value_type)) {
+            m_buffer.close();
+            throw std::runtime_error("mmap_vector: file size (which is " + std::to_string(file_size)
+                                     + ") is not a multiple of the element size");
+        }
+
+        m_size = file_size / sizeof(value_type);
+        m_capacity = m_size;
+        m_buffer.remap_whole(file_size);
+        m_dirty.resize(region_count(m_capacity), 0);
+    }
+
+    explicit mmap_vector(const char* file_path)
+        : mmap_vector(std::string(file_path))
+    {}
+
+    /// Two containers must not own the same file, so the container is not copyable.
+    mmap_vector(const mmap_vector& orig) = delete;
+
+    mmap_vector(mmap_vector&& orig)
+        : m_buffer(std::move(orig.m_buffer))
+        , m_size(orig.m_size)
+        , m_capacity(orig.m_capacity)
+        , m_dirty(std::move(orig.m_dirty))
+        , m_all_dirty(orig.m_all_dirty)
+    {
+        orig.m_size = 0;
+        orig.m_capacity = 0;
+        orig.m_all_dirty = false;
+    }
+
+    virtual ~mmap_vector()
+    {
+        if (! m_buffer.is_open()) {
+            return;
+        }
+
+        try {
+            close();
+        } catch (...) {
+            // The size of the file stays equal to the capacity.
+        }
+    }
+
+    /// @brief  Set the access pattern hint for the container.
+    void advise(advice adv) { m_buffer.advise(adv); }
+
+    reference at(size_type pos)
+    {
+        check_range(pos);
+        return (*this)[pos];
+    }
+
+    const_reference at(size_type pos) const
+    {
+        check_range(pos);
+        return (*this)[pos];
+    }
+
+    reference back() { return (*this)[size() - 1]; }
+
+    const_reference back() const { return (*this)[size() - 1]; }
+
+    iterator begin()
+    {
+        m_all_dirty = true;
+        return data();
+    }
+
+    const_iterator begin() const { return data(); }
+
+    size_type capacity() const { return m_capacity; }
+
+    const_iterator cbegin() const { return data(); }
+
+    const_iterator cend() const { return data() + m_size; }
+
+    void clear() { m_size = 0; }
+
+    /// @brief  Unmap the file, set the size of the file to the size of the container and close it.
+    /// @throw  std::runtime_error if can not change the size of the file.
+    void close()
+    {
+        assert(m_buffer.is_open());
+
+        m_buffer.unmap();
+        const size_t size = m_size * sizeof(value_type);
+        m_size = 0;
+        m_capacity = 0;
+        m_dirty.clear();
+        m_all_dirty = false;
+        try {
+            m_buffer.resize_file(size);
+        } catch (...) {
+            m_buffer.close();
+            throw;
+        }
+        m_buffer.close();
+    }
+
+    pointer data()
+    {
+        m_all_dirty = true;
+        return m_buffer.p_whole;
+    }
+
+    const_pointer data() const { return m_buffer.p_whole; }
+
+    bool empty() const { return (size() == 0); }
+
+    iterator end() { return data() + m_size; }
+
+    /// @brief  Write the modified elements [pos, pos + count) to the file and wait for the writeback.
+    /// @throw  std::runtime_error if can not write the elements.
+    void flush(size_type pos, size_type count)
+    {
+        assert(pos + count <= m_size);
+
+        m_buffer.flush(pos * sizeof(value_type), (pos + count) * sizeof(value_type), false);
+
+        // Regions entirely inside the range are clean now.
+        const size_type first = ((pos * sizeof(value_type)) + (size_t(1) << s_dirty_shift) - 1) >> s_dirty_shift;
+        const size_type last = ((pos + count) * sizeof(value_type)) >> s_dirty_shift;
+        for (size_type r = first; r < last; ++r) {
+            m_dirty[r] = 0;
+        }
+    }
+
+    /// @brief  Start the writeback of the modified regions of the file without waiting for it.
+    /// @details    The regions stay marked as modified until sync(), which waits
+    ///             only for the writeback that is not finished yet.
+    /// @throw  std::runtime_error if can not start the writeback.
+    void flush_async() { flush_dirty(true); }
+
+    /// @brief  Start the writeback of the modified elements [pos, pos + count) without waiting for it.
+    /// @throw  std::runtime_error if can not start the writeback.
+    void flush_async(size_type pos, size_type count)
+    {
+        assert(pos + count <= m_size);
+        m_buffer.flush(pos * sizeof(value_type), (pos + count) * sizeof(value_type), true);
+    }
+
+    const_iterator end() const { return data() + m_size; }
+
+    bool is_open() const { return m_buffer.is_open(); }
+
+    void pop_back()
+    {
+        assert(! empty());
+        --m_size;
+    }
+
+    /// @brief  Append the element, the capacity grows geometrically.
+    /// @throw  std::runtime_error if can not extend or map the file.
+    void push_back(const value_type& val)
+    {
+        if (m_size == m_capacity) {
+            // The element may belong to the container, so it is copied before the remapping.
+            const value_type tmp = val;
+            reserve(grow_capacity(m_size + 1));
+            mark_dirty(m_size);
+            m_buffer.p_whole[m_size++] = tmp;
+            return;
+        }
+        mark_dirty(m_size);
+        m_buffer.p_whole[m_size++] = val;
+    }
+
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    /// @brief  Extend the file and the mapping to the count of the elements.
+    /// @throw  std::runtime_error if can not extend or map the file.
+    void reserve(size_type count)
+    {
+        if (count > m_capacity) {
+            reallocate(count);
+        }
+    }
+
+    /// @brief  Reset the counters of the mapping activity.
+    void reset_stats() { m_buffer.counters.reset(); }
+
+    /// @brief  Resize the container, new elements are value-initialized.
+    /// @throw  std::runtime_error if can not extend or map the file.
+    void resize(size_type count) { resize(count, value_type()); }
+
+    /// @brief  Resize the container, new elements are copies of the value.
+    /// @throw  std::runtime_error if can not extend or map the file.
+    void resize(size_type count, const value_type& val)
+    {
+        if (count > m_capacity) {
+            const value_type tmp = val;
+            reserve(grow_capacity(count));
+            fill(count, tmp);
+        } else if (count > m_size) {
+            fill(count, val);
+        }
+        m_size = count;
+    }
+
+    /// @brief  Truncate the file and the mapping to the size of the container.
+    /// @throw  std::runtime_error if can not truncate or map the file.
+    void shrink_to_fit()
+    {
+        if (m_capacity > m_size) {
+            reallocate(m_size);
+        }
+    }
+
+    size_type size() const { return m_size; }
+
+    /// @brief  Counters of the mapping activity, zero without MFCNT_STATS.
+    mfcnt::stats stats() const { return m_buffer.counters.get(); }
+
+    void swap(mmap_vector& orig)
+    {
+        m_buffer.swap(orig.m_buffer);
+        std::swap(m_size, orig.m_size);
+        std::swap(m_capacity, orig.m_capacity);
+        std::swap(m_dirty, orig.m_dirty);
+        std::swap(m_all_dirty, orig.m_all_dirty);
+    }
+
+    /// @brief  Write the modified regions of the file to the storage and wait for it.
+    /// @note   While the container is open the size of the file is the capacity,
+    ///         so the elements past the size are zeroes after a crash.
+    /// @throw  std::runtime_error if can not write the regions or synchronize the file.
+    void sync()
+    {
+        if (! m_buffer.is_open()) {
+            return;
+        }
+        flush_dirty(false);
+        m_buffer.sync();
+    }
+
+    mmap_vector& operator=(const mmap_vector& orig) = delete;
+
+    mmap_vector& operator=(mmap_vector&& orig)
+    {
+        if (this != &orig) {
+            mmap_vector(std::move(orig)).swap(*this);
+        }
+        return *this;
+    }
+
+    reference operator[](size_type pos)
+    {
+        assert(pos < size());
+        mark_dirty(pos);
+        return m_buffer.p_whole[pos];
+    }
+
+    const_reference operator[](size_type pos) const
+    {
+        assert(pos < size());
+        return m_buffer.p_whole[pos];
+    }
+
+private:
+    /// @brief  Сheck for exceeding the permissible range.
+    /// @throw  std::runtime_error if the value exceeds the permissible limits.
+    void check_range(size_type pos) const
+    {
+        if (pos >= m_size) {
+            throw std::runtime_error("mmap_vector::check_range: pos (which is "
+                                     + std::to_string(pos) + ") >= this->size() (which is "
+                                     + std::to_string(m_size) + ")");
+        }
+    }
+
+    /// @brief  Fill the elements [m_size, count) with the value.
+    void fill(size_type count, const value_type& val)
+    {
+        const size_type last = ((count - 1) * sizeof(value_type)) >> s_dirty_shift;
+        for (size_type r = (m_size * sizeof(value_type)) >> s_dirty_shift; r <= last; ++r) {
+            m_dirty[r] = 1;
+        }
+        std::fill(m_buffer.p_whole + m_size, m_buffer.p_whole + count, val);
+    }
+
+    /// @brief  Write the modified regions of the file.
+    /// @param  async - start the writeback and return without waiting for it,
+    ///                 the regions stay marked as modified.
+    void flush_dirty(bool async)
+    {
+        const size_t length = m_capacity * sizeof(value_type);
+        if (m_all_dirty) {
+            m_buffer.flush(0, length, async);
+        } else {
+            for (size_type r = 0; r < m_dirty.size(); ++r) {
+                if (! m_dirty[r]) {
+                    continue;
+                }
+                size_type last = r + 1;
+                while (last < m_dirty.size() && m_dirty[last]) {
+                    ++last;
+                }
+                // The last element of the region may spread to the next region.
+                const size_t last_byte = (last << s_dirty_shift) + sizeof(value_type);
+                m_buffer.flush(r << s_dirty_shift, std::min(last_byte, length), async);
+                r = last;
+            }
+        }
+
+        if (! async) {
+            std::fill(m_dirty.begin(), m_dirty.end(), 0);
+            m_all_dirty = false;
+        }
+    }
+
+    /// @brief  Mark the region of the element as modified.
+    void mark_dirty(size_type pos) { m_dirty[(pos * sizeof(value_type)) >> s_dirty_shift] = 1; }
+
+    /// @brief  Number of the tracked regions of the count of the elements.
+    static size_type region_count(size_type count)
+    {
+        return (count * sizeof(value_type) + (size_t(1) << s_dirty_shift) - 1) >> s_dirty_shift;
+    }
+
+    /// @brief  Capacity for at least the count of the elements: the doubled
+    ///         capacity, but not less than one memory page.
+    size_type grow_capacity(size_type count) const
+    {
+        const size_type page_count = std::max<size_type>(details::utils::memory_page_size() / sizeof(value_type), 1);
+        return std::max(std::max(count, 2 * m_capacity), page_count);
+    }
+
+    void reallocate(size_type count)
+    {
+        assert(m_buffer.is_open());
+        assert(count >= m_size);
+
+        const size_t length = count * sizeof(value_type);
+        if (count > m_capacity) {
+            m_buffer.resize_file(length);
+            m_buffer.remap_whole(length);
+        } else {
+            m_buffer.remap_whole(length);
+            m_buffer.resize_file(length);
+        }
+        m_capacity = count;
+        m_dirty.resize(region_count(m_capacity), 0);
+    }
+
+private:
+    _mapper m_buffer;
+    size_t m_size;
+    size_t m_capacity;
+
+    /// Flags of the modified regions of kChunkSize bytes.
+    std::vector<uint8_t> m_dirty;
+    bool m_all_dirty;
+};
+
+MFCNT_INLINE_NAMESPACE_END
+} // namespace mfcnt
+
+#endif /* _MMAP_CONTAINERS_MFCNT_MMAP_VECTOR_H */
@@ -25,7 +25,21 @@
 #ifndef _MMAP_CONTAINERS_MFCNT_TYPES_H
 #define _MMAP_CONTAINERS_MFCNT_TYPES_H
 
+#include <cstddef>
+#include <cstdint>
+
+/// The containers embed the counters of the mapping activity, which are
+/// compiled out without MFCNT_STATS, so the translation units built with and
+/// without the macro declare the library in the distinct inline namespaces.
+#ifdef MFCNT_STATS
+    #define MFCNT_INLINE_NAMESPACE_BEGIN inline namespace stats_on {
+#else
+    #define MFCNT_INLINE_NAMESPACE_BEGIN inline namespace stats_off {
+#endif
+#define MFCNT_INLINE_NAMESPACE_END }
+
 namespace mfcnt {
+MFCNT_INLINE_NAMESPACE_BEGIN
 
 enum mode
 {
@@ -34,6 +48,61 @@ enum mode
     RW_SHARED   // Read/write access, writes are propagated to disk.
 };
 
+enum map_policy
+{
+    SEGMENTED,  // The file is mapped by windows of fixed size.
+    WHOLE_FILE, // The whole range is mapped once if the address space allows it.
+    CONCURRENT  // Windows are mapped on first access and kept until the container
+                // is closed, so one container can be read by several threads.
+                // The chunks are never unmapped, so the range of more than
+                // kMaxConcurrentChunkCount chunks (32 GiB) is mapped whole.
+};
+
+enum load_policy
+{
+    POPULATE,   // The kernel reads the pages when the range is mapped (MAP_POPULATE).
+    PREFAULT    // A pool of threads touches the pages of the range in parallel.
+};
+
+enum advice
+{
+    NORMAL,     // No special treatment.
+    SEQUENTIAL, // Pages are accessed sequentially, aggressive read-ahead.
+    RANDOM,     // Pages are accessed randomly, read-ahead is disabled.
+    WILLNEED,   // Pages will be accessed in the near future, read them ahead.
+    DONTNEED    // Pages will not be accessed in the near future.
+};
+
+enum page_policy
+{
+    BASE_PAGES, // Mappings are aligned with the page of the file.
+    HUGE_PAGES  // Mappings are aligned with the huge page and backed by transparent
+                // huge pages where the file system allows it, e.g. tmpfs.
+};
+
+/// @brief  Counters of the mapping activity of the container.
+/// @note   The counters are collected only if MFCNT_STATS is defined before
+///         the headers are included, otherwise they are zero.
+struct stats
+{
+    size_t remaps;          // Mappings of the windows of the file.
+    size_t unmaps;          // Unmappings of the windows.
+    size_t mapped_bytes;    // Total length of the mappings in bytes.
+    size_t hits;            // Windows found mapped.
+    size_t misses;          // Windows mapped on the access.
+    size_t buf_changes;     // Windows changed by the iterators.
+    size_t minor_faults;    // Page faults of the process served without I/O.
+    size_t major_faults;    // Page faults of the process which read the disk.
+    uint64_t syscall_nsecs; // Time spent in the mapping system calls.
+
+    /// @brief  Share of the windows found mapped, 0 if there were no accesses.
+    double hit_ratio() const
+    {
+        return (hits + misses) ? double(hits) / double(hits + misses) : 0.0;
+    }
+};
+
+MFCNT_INLINE_NAMESPACE_END
 } // namespace mfcnt
 
 #endif /* _MMAP_CONTAINERS_MFCNT_TYPES_H */
@@ -22,20 +22,95 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <deque>
 #include <filesystem>
+#include <fstream>
 #include <list>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
+extern "C" {
+    #include <fcntl.h>
+    #include <unistd.h>
+}
+
 #include <testing/perfdefs.h>
 #include <testing/utils.h>
 
 #include "utils.h"
+#include "mfcnt/algorithm.h"
+#include "mfcnt/mmap_append_log.h"
 #include "mfcnt/mmap_deque_view.h"
 #include "mfcnt/mmap_list_view.h"
+#include "mfcnt/mmap_sorted_view.h"
 
 namespace {
 
+/// Number of the point lookups of the access pattern tests.
+constexpr size_t kAccessCount = 1 << 18;
+
+/// Stride of the strided access, larger than the window of the views.
+constexpr size_t kStride = 4 * 1024 * 1024 + 4099;
+
+/// Number of the point lookups of each thread of the scaling tests.
+constexpr size_t kThreadAccessCount = 1 << 16;
+
+/// Number of the elements scanned between the latency samples of the scaling tests.
+constexpr size_t kScanBlock = 64 * 1024;
+
+template<typename TTp>
+struct mmap_deque_whole_view : public mfcnt::mmap_deque_view<TTp>
+{
+    using base = mfcnt::mmap_deque_view<TTp>;
+
+    mmap_deque_whole_view()
+        : base()
+    {}
+
+    explicit mmap_deque_whole_view(const std::filesystem::path& file)
+        : base(file.string(), 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::WHOLE_FILE)
+    {}
+};
+
+// Views which can be read by several threads at once.
+template<typename TTp>
+struct mmap_deque_concurrent_view : public mfcnt::mmap_deque_view<TTp>
+{
+    using base = mfcnt::mmap_deque_view<TTp>;
+
+    mmap_deque_concurrent_view()
+        : base()
+    {}
+
+    explicit mmap_deque_concurrent_view(const std::filesystem::path& file)
+        : base(file.string(), 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::CONCURRENT)
+    {}
+};
+
+template<typename TTp>
+struct mmap_list_concurrent_view : public mfcnt::mmap_list_view<TTp>
+{
+    using base = mfcnt::mmap_list_view<TTp>;
+
+    mmap_list_concurrent_view()
+        : base()
+    {}
+
+    explicit mmap_list_concurrent_view(const std::filesystem::path& file)
+        : base(file.string(), 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::CONCURRENT)
+    {}
+};
+
 class mfcnt_env : public ::testing::utils::base_env
 {
     using base = ::testing::utils::base_env;
@@ -65,6 +140,23 @@ public:
 
 //        m_file_250_Mb = work_dir() / "tmp_file_250_Mb";
 //        PERF_ASSERT_TRUE(ut::create_test_file(m_file_250_Mb, tests::kTestData, 250 * 1024 * 1024));
+
+        m_file_sorted_10_Mb = work_dir() / "tmp_file_sorted_10_Mb";
+        PERF_ASSERT_TRUE(create_sorted_file(m_file_sorted_10_Mb, 10 * 1024 * 1024));
+
+        m_file_sorted_50_Mb = work_dir() / "tmp_file_sorted_50_Mb";
+        PERF_ASSERT_TRUE(create_sorted_file(m_file_sorted_50_Mb, 50 * 1024 * 1024));
+
+        // Files of several GB are too slow for the regular run, so they are created on demand.
+        const char* p_large_size = std::getenv("MFCNT_PERF_LARGE_FILE_MB");
+        const size_t large_size = p_large_size ? std::strtoull(p_large_size, nullptr, 10) : 0;
+        if (large_size != 0) {
+            m_file_large = work_dir() / "tmp_file_large";
+            PERF_ASSERT_TRUE(ut::create_test_file(m_file_large, tests::kTestData, large_size * 1024 * 1024));
+
+            m_file_sorted_large = work_dir() / "tmp_file_sorted_large";
+            PERF_ASSERT_TRUE(create_sorted_file(m_file_sorted_large, large_size * 1024 * 1024));
+        }
     }
 
     static const std::filesystem::path& file_10_Mb() { return m_file_10_Mb; }
@@ -72,29 +164,167 @@ public:
     static const std::filesystem::path& file_50_Mb() { return m_file_50_Mb; }
     static const std::filesystem::path& file_100_Mb() { return m_file_100_Mb; }
     static const std::filesystem::path& file_250_Mb() { return m_file_250_Mb; }
+    static const std::filesystem::path& file_large() { return m_file_large; }
+    static const std::filesystem::path& file_sorted_10_Mb() { return m_file_sorted_10_Mb; }
+    static const std::filesystem::path& file_sorted_50_Mb() { return m_file_sorted_50_Mb; }
+    static const std::filesystem::path& file_sorted_large() { return m_file_sorted_large; }
+
+    /// @brief  The cold cache mode is enabled by the MFCNT_PERF_COLD_CACHE environment variable.
+    static bool cold_cache()
+    {
+        static const bool cold = (std::getenv("MFCNT_PERF_COLD_CACHE") != nullptr);
+        return cold;
+    }
+
+    /// @brief  Drop the pages of the file from the page cache in the cold cache
+    ///         mode, so the timed section reads the file from the disk.
+    /// @note   The pages mapped to the page tables of a process are not dropped.
+    static void drop_cache(const std::filesystem::path& file)
+    {
+        if (! cold_cache() || file.empty()) {
+            return;
+        }
+
+        const int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return;
+        }
+        // Dirty pages are not dropped, so they are written first.
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+
+    static double throughput(size_t bytes, double msecs)
+    {
+        return (msecs > 0.0) ? (double(bytes) / (1024.0 * 1024.0)) / (msecs / 1000.0) : 0.0;
+    }
+
+    /// @brief  Numbers of the threads of the scaling tests: 1, 2, 4, ... and
+    ///         the number of the hardware threads or MFCNT_PERF_THREADS.
+    static std::vector<size_t> thread_counts()
+    {
+        const char* p_threads = std::getenv("MFCNT_PERF_THREADS");
+        size_t max_count = p_threads ? std::strtoull(p_threads, nullptr, 10) : std::thread::hardware_concurrency();
+        max_count = (max_count != 0) ? max_count : 1;
+
+        std::vector<size_t> counts;
+        for (size_t count = 1; count < max_count; count *= 2) {
+            counts.push_back(count);
+        }
+        counts.push_back(max_count);
+        return counts;
+    }
+
+    /// @brief  Percentiles of the latencies of the operations in nanoseconds.
+    static std::string percentiles(std::vector<uint64_t>& latencies)
+    {
+        if (latencies.empty()) {
+            return "no samples";
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        const auto at = [&latencies](double p) { return latencies[size_t(p * double(latencies.size() - 1))]; };
+
+        std::ostringstream sout;
+        sout << "p50 " << at(0.5) << " ns, p99 " << at(0.99) << " ns, p99.9 " << at(0.999) << " ns";
+        return sout.str();
+    }
+
+    template<typename TCnt>
+    static constexpr bool is_stl_cnt()
+    {
+        return std::is_same<TCnt, std::deque<char>>::value ||
+               std::is_same<TCnt, std::list<char>>::value ||
+               std::is_same<TCnt, std::vector<char>>::value;
+    }
+
+    template<typename TCnt>
+    static constexpr bool is_sorted_view()
+    {
+        return std::is_same<TCnt, mfcnt::mmap_sorted_view<uint64_t>>::value;
+    }
 
     template<typename TCnt>
     static TCnt cnt_from_file(const std::filesystem::path& file)
     {
         using cnt_type = TCnt;
-        if constexpr (std::is_same<cnt_type, std::deque<char>>::value ||
-                      std::is_same<cnt_type, std::list<char>>::value ||
-                      std::is_same<cnt_type, std::vector<char>>::value) {
+        if (file.empty()) {
+            return cnt_type();
+        }
+        if constexpr (std::is_same<cnt_type, std::vector<uint64_t>>::value) {
+            cnt_type cnt(std::filesystem::file_size(file) / sizeof(uint64_t));
+            std::ifstream fin(file, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(cnt.data()), cnt.size() * sizeof(uint64_t));
+            return cnt;
+        } else if constexpr (is_stl_cnt<cnt_type>()) {
             return ::tests::details::utils::create_stl_cnt<cnt_type>(file);
         } else {
             return cnt_type(file);
         }
     }
 
+    /// @brief  Positions of the uniform random point lookups.
+    static std::vector<size_t> random_positions(size_t size)
+    {
+        std::mt19937_64 gen(42);
+        std::uniform_int_distribution<size_t> dist(0, size - 1);
+        std::vector<size_t> positions(kAccessCount);
+        for (size_t& pos : positions) {
+            pos = dist(gen);
+        }
+        return positions;
+    }
+
+    /// @brief  Positions of the Zipfian (s = 1) point lookups.
+    /// @details    The rank is log-uniform, which approximates the Zipf law
+    ///             with s = 1, and the ranks are scattered over the container,
+    ///             so the hot elements belong to different windows.
+    static std::vector<size_t> zipf_positions(size_t size)
+    {
+        std::mt19937_64 gen(42);
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        const double log_size = std::log(double(size) + 1.0);
+        std::vector<size_t> positions(kAccessCount);
+        for (size_t& pos : positions) {
+            const size_t rank = std::min(size_t(std::exp(dist(gen) * log_size)) - 1, size - 1);
+            pos = (rank * 0x9E3779B97F4A7C15ULL) % size;
+        }
+        return positions;
+    }
+
 private:
     std::filesystem::path work_dir() const { return base::work_dir(); }
 
+    /// @brief  Create the file of the sorted 64-bit keys with the gaps.
+    static bool create_sorted_file(const std::filesystem::path& file, size_t size)
+    {
+        std::ofstream fout(file, std::ios::binary);
+        if (! fout.is_open()) {
+            return false;
+        }
+
+        std::vector<uint64_t> buffer(64 * 1024);
+        for (uint64_t key = 0; key < size / sizeof(uint64_t);) {
+            size_t count = 0;
+            for (; count < buffer.size() && key < size / sizeof(uint64_t); ++count, ++key) {
+                buffer[count] = 3 * key;
+            }
+            fout.write(reinterpret_cast<const char*>(buffer.data()), count * sizeof(uint64_t));
+        }
+        return fout.good();
+    }
+
 private:
     static std::filesystem::path m_file_10_Mb;
     static std::filesystem::path m_file_25_Mb;
     static std::filesystem::path m_file_50_Mb;
     static std::filesystem::path m_file_100_Mb;
     static std::filesystem::path m_file_250_Mb;
+    static std::filesystem::path m_file_large;
+    static std::filesystem::path m_file_sorted_10_Mb;
+    static std::filesystem::path m_file_sorted_50_Mb;
+    static std::filesystem::path m_file_sorted_large;
 };
 
 std::filesystem::path mfcnt_env::m_file_10_Mb = {};
@@ -102,6 +332,10 @@ std::filesystem::path mfcnt_env::m_file_25_Mb = {};
 std::filesystem::path mfcnt_env::m_file_50_Mb = {};
 std::filesystem::path mfcnt_env::m_file_100_Mb = {};
 std::filesystem::path mfcnt_env::m_file_250_Mb = {};
+std::filesystem::path mfcnt_env::m_file_large = {};
+std::filesystem::path mfcnt_env::m_file_sorted_10_Mb = {};
+std::filesystem::path mfcnt_env::m_file_sorted_50_Mb = {};
+std::filesystem::path mfcnt_env::m_file_sorted_large = {};
 
 template<typename TType>
 class mfcnt_common : public ::testing::Test
@@ -114,8 +348,8 @@ public:
         m_cnt_10_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_10_Mb()));
         m_cnt_25_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_25_Mb()));
         m_cnt_50_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_50_Mb()));
-        m_cnt_100_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_100_Mb()));
-        m_cnt_250_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_250_Mb()));
+//        m_cnt_100_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_100_Mb()));
+//        m_cnt_250_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_250_Mb()));
     }
 
 protected:
@@ -137,8 +371,8 @@ public:
         m_cnt_10_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_10_Mb()));
         m_cnt_25_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_25_Mb()));
         m_cnt_50_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_50_Mb()));
-        m_cnt_100_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_100_Mb()));
-        m_cnt_250_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_250_Mb()));
+//        m_cnt_100_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_100_Mb()));
+//        m_cnt_250_Mb = std::move(mfcnt_env::cnt_from_file<cnt_t>(mfcnt_env::file_250_Mb()));
     }
 
 protected:
@@ -149,7 +383,71 @@ protected:
     cnt_t m_cnt_250_Mb;
 };
 
+template<typename TType>
+class mfcnt_algo : public mfcnt_common<TType>
+{};
+
+/// @brief  Files of the random data for the access patterns.
+struct access_files
+{
+    static const std::filesystem::path& file_10MB() { return mfcnt_env::file_10_Mb(); }
+    static const std::filesystem::path& file_50MB() { return mfcnt_env::file_50_Mb(); }
+    static const std::filesystem::path& file_large() { return mfcnt_env::file_large(); }
+};
+
+/// @brief  Files of the sorted records for the binary search.
+struct sorted_files
+{
+    static const std::filesystem::path& file_10MB() { return mfcnt_env::file_sorted_10_Mb(); }
+    static const std::filesystem::path& file_50MB() { return mfcnt_env::file_sorted_50_Mb(); }
+    static const std::filesystem::path& file_large() { return mfcnt_env::file_sorted_large(); }
+};
+
+/// @brief  Containers of the 10 MB, 50 MB and large files of the set TFiles.
+template<typename TType, typename TFiles>
+class mfcnt_file_set : public ::testing::Test
+{
+    using cnt_t = TType;
+
+public:
+    virtual void SetUp() override
+    {
+        m_file_10MB = TFiles::file_10MB();
+        m_file_50MB = TFiles::file_50MB();
+        m_file_large = TFiles::file_large();
+
+        m_cnt_10MB = std::move(mfcnt_env::cnt_from_file<cnt_t>(m_file_10MB));
+        m_cnt_50MB = std::move(mfcnt_env::cnt_from_file<cnt_t>(m_file_50MB));
+        m_cnt_large = std::move(mfcnt_env::cnt_from_file<cnt_t>(m_file_large));
+    }
+
+protected:
+    std::filesystem::path m_file_10MB;
+    std::filesystem::path m_file_50MB;
+    std::filesystem::path m_file_large;
+
+    cnt_t m_cnt_10MB;
+    cnt_t m_cnt_50MB;
+    cnt_t m_cnt_large;
+};
+
+template<typename TType>
+class mfcnt_access : public mfcnt_file_set<TType, access_files>
+{};
+
+template<typename TType>
+class mfcnt_threads : public mfcnt_access<TType>
+{};
+
+class mfcnt_log : public ::testing::Test
+{};
+
+template<typename TType>
+class mfcnt_sorted : public mfcnt_file_set<TType, sorted_files>
+{};
+
 using types_common = testing::Types<mfcnt::mmap_deque_view<char>,
+                                    mmap_deque_whole_view<char>,
                                     mfcnt::mmap_list_view<char>,
                                     std::deque<char>,
                                     //std::list<char>,
@@ -157,18 +455,140 @@ using types_common = testing::Types<mfcnt::mmap_deque_view<char>,
 TYPED_PERF_TEST_SUITE(mfcnt_common, types_common);
 
 using types_line = testing::Types<mfcnt::mmap_deque_view<char>,
+                                  mmap_deque_whole_view<char>,
                                   std::deque<char>,
                                   std::vector<char>>;
 TYPED_PERF_TEST_SUITE(mfcnt_line, types_line);
 
+// The mmap containers use the segmented algorithms of the mfcnt/algorithm.h,
+// the std::vector is the reference.
+using types_algo = testing::Types<mfcnt::mmap_deque_view<char>,
+                                  mmap_deque_whole_view<char>,
+                                  mfcnt::mmap_list_view<char>,
+                                  std::vector<char>>;
+TYPED_PERF_TEST_SUITE(mfcnt_algo, types_algo);
+
+// Access patterns which do not fit into the windows of the views.
+using types_access = testing::Types<mfcnt::mmap_deque_view<char>,
+                                    mmap_deque_whole_view<char>,
+                                    mfcnt::mmap_list_view<char>,
+                                    std::vector<char>>;
+TYPED_PERF_TEST_SUITE(mfcnt_access, types_access);
+
+// Containers which can be read by several threads at once.
+using types_threads = testing::Types<mmap_deque_concurrent_view<char>,
+                                     mmap_deque_whole_view<char>,
+                                     mmap_list_concurrent_view<char>,
+                                     std::vector<char>>;
+TYPED_PERF_TEST_SUITE(mfcnt_threads, types_threads);
+
+using types_sorted = testing::Types<mfcnt::mmap_deque_view<uint64_t>,
+                                    mmap_deque_whole_view<uint64_t>,
+                                    mfcnt::mmap_list_view<uint64_t>,
+                                    mfcnt::mmap_sorted_view<uint64_t>,
+                                    std::vector<uint64_t>>;
+TYPED_PERF_TEST_SUITE(mfcnt_sorted, types_sorted);
+
+/// @brief  Wall time of the threads and the latencies of their operations.
+struct threads_result
+{
+    double msecs = 0.0;
+    size_t dummy = 0;
+    std::vector<uint64_t> latencies;
+};
+
+/// @brief  Run the body in the threads released at once.
+/// @param  thread_count - number of the threads.
+/// @param  body         - callable (thread_num, latencies) which appends the latencies
+///                        of its operations in nanoseconds and returns a dummy sum.
+template<typename TBody>
+threads_result run_threads(size_t thread_count, const TBody& body)
+{
+    std::vector<std::vector<uint64_t>> latencies(thread_count);
+    std::vector<size_t> dummies(thread_count, 0);
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> start(false);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (! start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            dummies[t] = body(t, latencies[t]);
+        });
+    }
+    while (ready.load(std::memory_order_acquire) != thread_count) {
+        std::this_thread::yield();
+    }
+
+    const std::chrono::steady_clock::time_point first = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    const std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
+    threads_result res;
+    res.msecs = std::chrono::duration<double, std::milli>(last - first).count();
+    for (size_t t = 0; t < thread_count; ++t) {
+        res.dummy += dummies[t];
+        res.latencies.insert(res.latencies.end(), latencies[t].begin(), latencies[t].end());
+    }
+    return res;
+}
+
+/// @brief  Scan the container by the blocks of kScanBlock elements and sample the latency of each block.
+template<typename TCnt>
+size_t scan_blocks(const TCnt& cnt, std::vector<uint64_t>& latencies)
+{
+    size_t dummy = 0;
+    typename TCnt::const_iterator it = cnt.cbegin();
+    for (size_t pos = 0; pos < cnt.size();) {
+        const size_t last = std::min(pos + kScanBlock, cnt.size());
+        const std::chrono::steady_clock::time_point first = std::chrono::steady_clock::now();
+        for (; pos < last; ++pos, ++it) {
+            dummy += *it;
+        }
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - first).count());
+    }
+    return dummy;
+}
+
+/// @brief  Probe the positions starting from the first one and sample the latency of each probe.
+/// @note   The latency includes the reading of the clock, about 20 ns.
+template<typename TCnt>
+size_t probe_positions(const TCnt& cnt, const std::vector<size_t>& positions, size_t first,
+                       std::vector<uint64_t>& latencies)
+{
+    size_t dummy = 0;
+    latencies.reserve(kThreadAccessCount);
+    for (size_t i = 0; i < kThreadAccessCount; ++i) {
+        const size_t pos = positions[(first + i) % positions.size()];
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        dummy += cnt[pos];
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    return dummy;
+}
+
 } // <anonymous> namespace
 
+// The scanned containers hold char, so the size is the number of bytes.
+#define PERF_REPORT_THROUGHPUT(sw_name, size)                               \
+    PERF_MESSAGE() << "  " #sw_name " throughput: "                         \
+                   << mfcnt_env::throughput(size, PERF_TIMER_MSECS(sw_name)) << " MB/s"
+
 #define TYPED_PERF_TEST_COPY_END_IT(file_size)                              \
     TYPED_PERF_TEST(mfcnt_common, copy_end_it_##file_size##MB)              \
     {                                                                       \
         using cnt_type = TypeParam;                                         \
         PERF_INIT_TIMER(copy_end_it);                                       \
         size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
         PERF_START_TIMER(copy_end_it);                                      \
         for (typename cnt_type::const_iterator it =                         \
                 this->m_cnt_##file_size##_Mb.begin();                       \
@@ -176,6 +596,8 @@ TYPED_PERF_TEST_SUITE(mfcnt_line, types_line);
             dummy += *it;                                                   \
         }                                                                   \
         PERF_PAUSE_TIMER(copy_end_it);                                      \
+        PERF_REPORT_THROUGHPUT(copy_end_it,                                 \
+            this->m_cnt_##file_size##_Mb.size());                           \
     }
 
 #define TYPED_PERF_TEST_NO_COPY_END_IT(file_size)                           \
@@ -186,12 +608,15 @@ TYPED_PERF_TEST_SUITE(mfcnt_line, types_line);
         size_t dummy = 0;                                                   \
         typename cnt_type::const_iterator end_it =                          \
             this->m_cnt_##file_size##_Mb.end();                             \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
         PERF_START_TIMER(no_copy_end_it);                                   \
         for (typename cnt_type::const_iterator it =                         \
                 this->m_cnt_##file_size##_Mb.begin(); it != end_it; ++it) { \
             dummy += *it;                                                   \
         }                                                                   \
         PERF_PAUSE_TIMER(no_copy_end_it);                                   \
+        PERF_REPORT_THROUGHPUT(no_copy_end_it,                              \
+            this->m_cnt_##file_size##_Mb.size());                           \
     }
 
 #define TYPED_PERF_TEST_OPERATOR(file_size)                                 \
@@ -199,11 +624,14 @@ TYPED_PERF_TEST_SUITE(mfcnt_line, types_line);
     {                                                                       \
         PERF_INIT_TIMER(operator[]);                                        \
         size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
         PERF_START_TIMER(operator[]);                                       \
         for (size_t i = 0; i < this->m_cnt_##file_size##_Mb.size(); ++i) {  \
             dummy += this->m_cnt_##file_size##_Mb[i];                       \
         }                                                                   \
         PERF_PAUSE_TIMER(operator[]);                                       \
+        PERF_REPORT_THROUGHPUT(operator[],                                  \
+            this->m_cnt_##file_size##_Mb.size());                           \
     }
 
 #define TYPED_PERF_TEST_AT_FUNC(file_size)                                  \
@@ -211,11 +639,313 @@ TYPED_PERF_TEST_SUITE(mfcnt_line, types_line);
     {                                                                       \
         PERF_INIT_TIMER(at_function);                                       \
         size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
         PERF_START_TIMER(at_function);                                      \
         for (size_t i = 0; i < this->m_cnt_##file_size##_Mb.size(); ++i) {  \
             dummy += this->m_cnt_##file_size##_Mb.at(i);                    \
         }                                                                   \
         PERF_PAUSE_TIMER(at_function);                                      \
+        PERF_REPORT_THROUGHPUT(at_function,                                 \
+            this->m_cnt_##file_size##_Mb.size());                           \
+    }
+
+#define TYPED_PERF_TEST_ACCUMULATE(file_size)                               \
+    TYPED_PERF_TEST(mfcnt_algo, accumulate_##file_size##MB)                 \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        PERF_INIT_TIMER(accumulate);                                        \
+        size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
+        PERF_START_TIMER(accumulate);                                       \
+        if constexpr (mfcnt_env::is_stl_cnt<cnt_type>()) {                  \
+            dummy = std::accumulate(this->m_cnt_##file_size##_Mb.begin(),   \
+                                    this->m_cnt_##file_size##_Mb.end(),     \
+                                    dummy);                                 \
+        } else {                                                            \
+            dummy = mfcnt::accumulate(this->m_cnt_##file_size##_Mb, dummy); \
+        }                                                                   \
+        PERF_PAUSE_TIMER(accumulate);                                       \
+        PERF_REPORT_THROUGHPUT(accumulate,                                  \
+            this->m_cnt_##file_size##_Mb.size());                           \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+#define TYPED_PERF_TEST_COUNT(file_size)                                    \
+    TYPED_PERF_TEST(mfcnt_algo, count_##file_size##MB)                      \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        PERF_INIT_TIMER(count);                                             \
+        std::ptrdiff_t dummy = 0;                                           \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
+        PERF_START_TIMER(count);                                            \
+        if constexpr (mfcnt_env::is_stl_cnt<cnt_type>()) {                  \
+            dummy = std::count(this->m_cnt_##file_size##_Mb.begin(),        \
+                               this->m_cnt_##file_size##_Mb.end(), '\n');   \
+        } else {                                                            \
+            dummy = mfcnt::count(this->m_cnt_##file_size##_Mb, '\n');       \
+        }                                                                   \
+        PERF_PAUSE_TIMER(count);                                            \
+        PERF_REPORT_THROUGHPUT(count,                                       \
+            this->m_cnt_##file_size##_Mb.size());                           \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+// The value and the sequence are not in the file, so the whole file is scanned.
+#define TYPED_PERF_TEST_FIND(file_size)                                     \
+    TYPED_PERF_TEST(mfcnt_algo, find_##file_size##MB)                       \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const cnt_type& cnt = this->m_cnt_##file_size##_Mb;                 \
+        PERF_INIT_TIMER(find);                                              \
+        bool found = true;                                                  \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
+        PERF_START_TIMER(find);                                             \
+        if constexpr (mfcnt_env::is_stl_cnt<cnt_type>()) {                  \
+            found = std::find(cnt.begin(), cnt.end(), '#') != cnt.end();    \
+        } else {                                                            \
+            found = mfcnt::find(cnt, '#') != cnt.cend();                    \
+        }                                                                   \
+        PERF_PAUSE_TIMER(find);                                             \
+        PERF_REPORT_THROUGHPUT(find, cnt.size());                           \
+        PERF_ASSERT_FALSE(found);                                           \
+    }
+
+#define TYPED_PERF_TEST_SEARCH(file_size)                                   \
+    TYPED_PERF_TEST(mfcnt_algo, search_##file_size##MB)                     \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const cnt_type& cnt = this->m_cnt_##file_size##_Mb;                 \
+        const std::string needle = "brick in the classroom";                \
+        PERF_INIT_TIMER(search);                                            \
+        bool found = true;                                                  \
+        mfcnt_env::drop_cache(mfcnt_env::file_##file_size##_Mb());          \
+        PERF_START_TIMER(search);                                           \
+        if constexpr (mfcnt_env::is_stl_cnt<cnt_type>()) {                  \
+            found = std::search(cnt.begin(), cnt.end(), needle.begin(),     \
+                                needle.end()) != cnt.end();                 \
+        } else {                                                            \
+            found = mfcnt::search(cnt, needle.begin(), needle.end())        \
+                    != cnt.cend();                                          \
+        }                                                                   \
+        PERF_PAUSE_TIMER(search);                                           \
+        PERF_REPORT_THROUGHPUT(search, cnt.size());                         \
+        PERF_ASSERT_FALSE(found);                                           \
+    }
+
+#define TYPED_PERF_TEST_LOAD(file_size)                                     \
+    TYPED_PERF_TEST(mfcnt_algo, load_##file_size##MB)                       \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const std::filesystem::path& file =                                 \
+            mfcnt_env::file_##file_size##_Mb();                             \
+        PERF_INIT_TIMER(load);                                              \
+        size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(file);                                        \
+        PERF_START_TIMER(load);                                             \
+        {                                                                   \
+            const cnt_type cnt = mfcnt_env::cnt_from_file<cnt_type>(file);  \
+            if constexpr (mfcnt_env::is_stl_cnt<cnt_type>()) {              \
+                dummy = std::accumulate(cnt.begin(), cnt.end(), dummy);     \
+            } else {                                                        \
+                dummy = mfcnt::accumulate(cnt, dummy);                      \
+            }                                                               \
+        }                                                                   \
+        PERF_PAUSE_TIMER(load);                                             \
+        PERF_REPORT_THROUGHPUT(load, this->m_cnt_##file_size##_Mb.size()); \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+#define TYPED_PERF_TEST_RANDOM(file_size)                                   \
+    TYPED_PERF_TEST(mfcnt_access, random_##file_size)                       \
+    {                                                                       \
+        if (this->m_cnt_##file_size.empty()) {                              \
+            return;                                                         \
+        }                                                                   \
+        const std::vector<size_t> positions =                               \
+            mfcnt_env::random_positions(this->m_cnt_##file_size.size());    \
+        PERF_INIT_TIMER(random);                                            \
+        size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(this->m_file_##file_size);                    \
+        PERF_START_TIMER(random);                                           \
+        for (const size_t pos : positions) {                                \
+            dummy += this->m_cnt_##file_size[pos];                          \
+        }                                                                   \
+        PERF_PAUSE_TIMER(random);                                           \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+#define TYPED_PERF_TEST_ZIPF(file_size)                                     \
+    TYPED_PERF_TEST(mfcnt_access, zipf_##file_size)                         \
+    {                                                                       \
+        if (this->m_cnt_##file_size.empty()) {                              \
+            return;                                                         \
+        }                                                                   \
+        const std::vector<size_t> positions =                               \
+            mfcnt_env::zipf_positions(this->m_cnt_##file_size.size());      \
+        PERF_INIT_TIMER(zipf);                                              \
+        size_t dummy = 0;                                                   \
+        mfcnt_env::drop_cache(this->m_file_##file_size);                    \
+        PERF_START_TIMER(zipf);                                             \
+        for (const size_t pos : positions) {                                \
+            dummy += this->m_cnt_##file_size[pos];                          \
+        }                                                                   \
+        PERF_PAUSE_TIMER(zipf);                                             \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+#define TYPED_PERF_TEST_STRIDE(file_size)                                   \
+    TYPED_PERF_TEST(mfcnt_access, stride_##file_size)                       \
+    {                                                                       \
+        const size_t size = this->m_cnt_##file_size.size();                 \
+        if (size == 0) {                                                    \
+            return;                                                         \
+        }                                                                   \
+        PERF_INIT_TIMER(stride);                                            \
+        size_t dummy = 0;                                                   \
+        size_t pos = 0;                                                     \
+        mfcnt_env::drop_cache(this->m_file_##file_size);                    \
+        PERF_START_TIMER(stride);                                           \
+        for (size_t i = 0; i < kAccessCount; ++i) {                         \
+            dummy += this->m_cnt_##file_size[pos];                          \
+            pos = (pos + kStride) % size;                                   \
+        }                                                                   \
+        PERF_PAUSE_TIMER(stride);                                           \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+#define TYPED_PERF_TEST_REVERSE(file_size)                                  \
+    TYPED_PERF_TEST(mfcnt_access, reverse_##file_size)                      \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        using rit_type = typename cnt_type::const_reverse_iterator;         \
+        PERF_INIT_TIMER(reverse);                                           \
+        size_t dummy = 0;                                                   \
+        const rit_type rend_it(this->m_cnt_##file_size.cbegin());           \
+        mfcnt_env::drop_cache(this->m_file_##file_size);                    \
+        PERF_START_TIMER(reverse);                                          \
+        for (rit_type it(this->m_cnt_##file_size.cend());                   \
+             it != rend_it; ++it) {                                         \
+            dummy += *it;                                                   \
+        }                                                                   \
+        PERF_PAUSE_TIMER(reverse);                                          \
+        PERF_REPORT_THROUGHPUT(reverse,                                     \
+            this->m_cnt_##file_size.size());                                \
+    }
+
+#define TYPED_PERF_TEST_LOWER_BOUND(file_size)                              \
+    TYPED_PERF_TEST(mfcnt_sorted, lower_bound_##file_size)                  \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const size_t size = this->m_cnt_##file_size.size();                 \
+        if (size == 0) {                                                    \
+            return;                                                         \
+        }                                                                   \
+        const std::vector<size_t> keys =                                    \
+            mfcnt_env::random_positions(3 * size);                          \
+        PERF_INIT_TIMER(lower_bound);                                       \
+        size_t dummy = 0;                                                   \
+        const typename cnt_type::const_iterator first =                     \
+            this->m_cnt_##file_size.cbegin();                               \
+        const typename cnt_type::const_iterator last =                      \
+            this->m_cnt_##file_size.cend();                                 \
+        mfcnt_env::drop_cache(this->m_file_##file_size);                    \
+        PERF_START_TIMER(lower_bound);                                      \
+        for (const size_t key : keys) {                                     \
+            if constexpr (mfcnt_env::is_sorted_view<cnt_type>()) {          \
+                dummy += this->m_cnt_##file_size.lower_bound(key);          \
+            } else {                                                        \
+                dummy += std::lower_bound(first, last, key) - first;        \
+            }                                                               \
+        }                                                                   \
+        PERF_PAUSE_TIMER(lower_bound);                                      \
+        PERF_ASSERT_TRUE(dummy != 0);                                       \
+    }
+
+// Every thread scans the whole container, the throughput is the total of the threads.
+#define TYPED_PERF_TEST_SCAN_SCALING(file_size)                             \
+    TYPED_PERF_TEST(mfcnt_threads, scan_scaling_##file_size)                \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const cnt_type& cnt = this->m_cnt_##file_size;                      \
+        if (cnt.empty()) {                                                  \
+            return;                                                         \
+        }                                                                   \
+        PERF_INIT_TIMER(scan_scaling);                                      \
+        for (const size_t thread_count : mfcnt_env::thread_counts()) {      \
+            mfcnt_env::drop_cache(this->m_file_##file_size);                \
+            PERF_START_TIMER(scan_scaling);                                 \
+            threads_result res = run_threads(thread_count,                  \
+                [&cnt](size_t, std::vector<uint64_t>& latencies) {          \
+                    return scan_blocks(cnt, latencies);                     \
+                });                                                         \
+            PERF_PAUSE_TIMER(scan_scaling);                                 \
+            PERF_MESSAGE() << "  threads " << thread_count << ": "          \
+                << mfcnt_env::throughput(thread_count * cnt.size(),         \
+                                         res.msecs) << " MB/s, block "      \
+                << mfcnt_env::percentiles(res.latencies);                   \
+            PERF_ASSERT_TRUE(res.dummy != 0);                               \
+        }                                                                   \
+    }
+
+// Every thread probes its own part of the random positions.
+#define TYPED_PERF_TEST_RANDOM_SCALING(file_size)                           \
+    TYPED_PERF_TEST(mfcnt_threads, random_scaling_##file_size)              \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const cnt_type& cnt = this->m_cnt_##file_size;                      \
+        if (cnt.empty()) {                                                  \
+            return;                                                         \
+        }                                                                   \
+        const std::vector<size_t> positions =                               \
+            mfcnt_env::random_positions(cnt.size());                        \
+        PERF_INIT_TIMER(random_scaling);                                    \
+        for (const size_t thread_count : mfcnt_env::thread_counts()) {      \
+            mfcnt_env::drop_cache(this->m_file_##file_size);                \
+            PERF_START_TIMER(random_scaling);                               \
+            threads_result res = run_threads(thread_count,                  \
+                [&cnt, &positions](size_t t,                                \
+                                   std::vector<uint64_t>& latencies) {      \
+                    return probe_positions(cnt, positions,                  \
+                                           t * kThreadAccessCount,          \
+                                           latencies);                      \
+                });                                                         \
+            PERF_PAUSE_TIMER(random_scaling);                               \
+            PERF_MESSAGE() << "  threads " << thread_count << ": "          \
+                << double(thread_count * kThreadAccessCount) / res.msecs    \
+                   / 1000.0 << " Mops/s, probe "                            \
+                << mfcnt_env::percentiles(res.latencies);                   \
+            PERF_ASSERT_TRUE(res.dummy != 0);                               \
+        }                                                                   \
+    }
+
+// The ranges of the whole windows are read by the copies of the container.
+#define TYPED_PERF_TEST_REDUCE_SCALING(file_size)                           \
+    TYPED_PERF_TEST(mfcnt_threads, reduce_scaling_##file_size)              \
+    {                                                                       \
+        using cnt_type = TypeParam;                                         \
+        const cnt_type& cnt = this->m_cnt_##file_size;                      \
+        if constexpr (! mfcnt_env::is_stl_cnt<cnt_type>()) {                \
+            PERF_INIT_TIMER(reduce_scaling);                                \
+            for (const size_t thread_count : mfcnt_env::thread_counts()) {  \
+                if (cnt.empty()) {                                          \
+                    break;                                                  \
+                }                                                           \
+                mfcnt_env::drop_cache(this->m_file_##file_size);            \
+                const std::chrono::steady_clock::time_point first =         \
+                    std::chrono::steady_clock::now();                       \
+                PERF_START_TIMER(reduce_scaling);                           \
+                const size_t lines = mfcnt::parallel_reduce(cnt, size_t(0), \
+                    [](char ch) { return size_t(ch == '\n'); },             \
+                    std::plus<size_t>(), thread_count);                     \
+                PERF_PAUSE_TIMER(reduce_scaling);                           \
+                const double msecs = std::chrono::duration<double,          \
+                    std::milli>(std::chrono::steady_clock::now() - first)   \
+                    .count();                                               \
+                PERF_MESSAGE() << "  threads " << thread_count << ": "      \
+                    << mfcnt_env::throughput(cnt.size(), msecs) << " MB/s"; \
+                PERF_ASSERT_TRUE(lines != 0);                               \
+            }                                                               \
+        }                                                                   \
     }
 
 #define DECLARE_TESTS_GROUP(group_name)     \
@@ -229,6 +959,54 @@ DECLARE_TESTS_GROUP(COPY_END_IT)
 DECLARE_TESTS_GROUP(NO_COPY_END_IT)
 DECLARE_TESTS_GROUP(OPERATOR)
 DECLARE_TESTS_GROUP(AT_FUNC)
+DECLARE_TESTS_GROUP(ACCUMULATE)
+DECLARE_TESTS_GROUP(COUNT)
+DECLARE_TESTS_GROUP(FIND)
+DECLARE_TESTS_GROUP(SEARCH)
+DECLARE_TESTS_GROUP(LOAD)
+
+// The large file is created if MFCNT_PERF_LARGE_FILE_MB is set, otherwise the test is empty.
+#define DECLARE_ACCESS_TESTS_GROUP(group_name)  \
+    TYPED_PERF_TEST_##group_name(10MB)          \
+    TYPED_PERF_TEST_##group_name(50MB)          \
+    TYPED_PERF_TEST_##group_name(large)
+
+DECLARE_ACCESS_TESTS_GROUP(RANDOM)
+DECLARE_ACCESS_TESTS_GROUP(ZIPF)
+DECLARE_ACCESS_TESTS_GROUP(STRIDE)
+DECLARE_ACCESS_TESTS_GROUP(REVERSE)
+DECLARE_ACCESS_TESTS_GROUP(LOWER_BOUND)
+DECLARE_ACCESS_TESTS_GROUP(SCAN_SCALING)
+DECLARE_ACCESS_TESTS_GROUP(RANDOM_SCALING)
+DECLARE_ACCESS_TESTS_GROUP(REDUCE_SCALING)
+
+// Every thread appends its own events of 64 bytes to the shared log.
+PERF_TEST_F(mfcnt_log, append_scaling)
+{
+    const size_t event_count = 1 << 20;
+    const std::string event(64, 'e');
+    const std::filesystem::path file = mfcnt_env::file_10_Mb().parent_path() / "tmp_log_file";
+    PERF_INIT_TIMER(append_scaling);
+    for (const size_t thread_count : mfcnt_env::thread_counts()) {
+        std::filesystem::remove(file);
+        mfcnt::mmap_append_log log(file.string(), (event.size() + 8) * event_count * thread_count);
+        PERF_START_TIMER(append_scaling);
+        const threads_result res = run_threads(thread_count,
+            [&log, &event, event_count](size_t, std::vector<uint64_t>&) {
+                size_t appended = 0;
+                for (size_t i = 0; i < event_count; ++i) {
+                    appended += log.append(event.data(), event.size()) ? 1 : 0;
+                }
+                return appended;
+            });
+        PERF_PAUSE_TIMER(append_scaling);
+        PERF_MESSAGE() << "  threads " << thread_count << ": "
+                       << thread_count * event_count / res.msecs / 1000.0 << " M events/s, "
+                       << mfcnt_env::throughput(log.size(), res.msecs) << " MB/s";
+        PERF_ASSERT_TRUE(res.dummy == thread_count * event_count);
+    }
+    std::filesystem::remove(file);
+}
 
 int main(int /*argc*/, char** /*argv*/)
 {
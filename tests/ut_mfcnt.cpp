@@ -1,10 +1,42 @@
+// The counters of the mapping activity are checked by the stats test.
+#define MFCNT_STATS
+
+extern "C" {
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+}
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include <testing/testdefs.h>
 #include <testing/utils.h>
 
+#include "mfcnt/algorithm.h"
+#include "mfcnt/mmap_append_log.h"
+#include "mfcnt/mmap_btree.h"
+#include "mfcnt/mmap_concurrent_hash_map.h"
 #include "mfcnt/mmap_deque_view.h"
+#include "mfcnt/mmap_line_index.h"
 #include "mfcnt/mmap_list_view.h"
+#include "mfcnt/mmap_record_view.h"
+#include "mfcnt/mmap_sorted_view.h"
+#include "mfcnt/mmap_static_hash_map.h"
+#include "mfcnt/mmap_vector.h"
 
 #include "utils.h"
 
@@ -103,6 +135,41 @@ using cnt_types = testing::Types<mfcnt::mmap_deque_view<char, 4096>,
                                  mfcnt::mmap_list_view<char, 4096>>;
 TYPED_TEST_SUITE(mfcnt_fixture, cnt_types);
 
+struct record
+{
+    uint64_t id;
+    uint64_t key;
+    uint64_t value;
+};
+
+std::string create_records_file(size_t count)
+{
+    const std::filesystem::path file = mfcnt_env::test_file().parent_path() / "records_file";
+    std::ofstream fout(file, std::ios::binary);
+    for (size_t i = 0; i < count; ++i) {
+        const record r = {i, i * 2, i * 3};
+        fout.write(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+    return file.string();
+}
+
+template<typename TCnt>
+void check_records(const TCnt& cnt, size_t first, size_t count)
+{
+    ASSERT_TRUE(cnt.size() == count) << cnt.size() << " != " << count;
+
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_TRUE(cnt[i].id == first + i) << cnt[i].id << " != " << first + i;
+        EXPECT_TRUE(cnt[i].value == (first + i) * 3) << cnt[i].value << " != " << (first + i) * 3;
+    }
+
+    size_t id = first;
+    for (typename TCnt::const_iterator it = cnt.cbegin(); it != cnt.cend(); ++it, ++id) {
+        EXPECT_TRUE(it->id == id) << it->id << " != " << id;
+    }
+    EXPECT_TRUE(id == first + count) << id << " != " << first + count;
+}
+
 } // <anonumous> namespace
 
 TYPED_TEST(mfcnt_fixture, at)
@@ -210,6 +277,326 @@ TYPED_TEST(mfcnt_fixture, swap)
     EXPECT_TRUE(cnt.at(0) == 'W') << "cnt.at(" << cnt.at(0) << ") == 'W'";
 }
 
+TYPED_TEST(mfcnt_fixture, window_cache)
+{
+    TypeParam cnt(this->test_file());
+    const std::string test_data = this->test_data();
+    EXPECT_TRUE(cnt.window_count() > 0);
+
+    cnt.set_window_count(3);
+    EXPECT_TRUE(cnt.window_count() == 3);
+
+    // Alternate between regions that live in different windows.
+    for (size_t i = 0; i < 3 * 4096; i += 7) {
+        const size_t i1 = i + 4096;
+        const size_t i2 = i + 3 * 4096;
+        EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+        EXPECT_TRUE(cnt[i1] == test_data[i1]) << cnt[i1] << " != " << test_data[i1];
+        EXPECT_TRUE(cnt[i2] == test_data[i2]) << cnt[i2] << " != " << test_data[i2];
+    }
+
+    // More regions than windows.
+    cnt.set_window_count(1);
+    for (size_t i = 0; i < cnt.size(); i += 4096 + 13) {
+        const size_t i1 = cnt.size() - 1 - i;
+        EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+        EXPECT_TRUE(cnt[i1] == test_data[i1]) << cnt[i1] << " != " << test_data[i1];
+    }
+}
+
+TYPED_TEST(mfcnt_fixture, whole_file)
+{
+    TypeParam cnt(this->test_file(), 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::WHOLE_FILE);
+    const std::string test_data = this->test_data();
+    ASSERT_TRUE(test_data.size() == cnt.size());
+    ASSERT_TRUE(cnt.data() != nullptr);
+
+    for (size_t i = 0; i < test_data.size(); ++i) {
+        EXPECT_TRUE(cnt.data()[i] == test_data[i]) << cnt.data()[i] << " != " << test_data[i];
+        EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+    }
+
+    typename TypeParam::const_iterator it = cnt.cbegin();
+    for (const char ch : test_data) {
+        EXPECT_TRUE(ch == *it) << ch << " != " << *it;
+        ++it;
+    }
+    EXPECT_TRUE(it == cnt.cend());
+
+    // The contiguous range has the pointer iterators.
+    const typename TypeParam::contiguous_range range = cnt.contiguous();
+    static_assert(std::is_same<typename TypeParam::contiguous_range::iterator, const char*>::value,
+                  "the contiguous range should have the pointer iterators");
+    EXPECT_TRUE(range.begin() == cnt.data());
+    EXPECT_TRUE(range.size() == cnt.size()) << range.size() << " != " << cnt.size();
+    EXPECT_TRUE(std::equal(range.begin(), range.end(), test_data.begin(), test_data.end()));
+
+    TypeParam cnt_copy(cnt);
+    ASSERT_TRUE(cnt_copy.data() != nullptr);
+    EXPECT_TRUE(cnt_copy.data() != cnt.data());
+    EXPECT_TRUE(cnt_copy.at(4097) == 'a') << "cnt_copy.at(" << cnt_copy.at(4097) << ") == 'a'";
+
+    TypeParam cnt_seg(this->test_file());
+    EXPECT_TRUE(cnt_seg.data() == nullptr);
+    EXPECT_TRUE(cnt_seg.contiguous().size() == 0);
+}
+
+TYPED_TEST(mfcnt_fixture, segments)
+{
+    TypeParam cnt(this->test_file());
+    const std::string test_data = this->test_data();
+
+    size_t pos = 0;
+    for (const auto& seg : cnt.segments()) {
+        EXPECT_TRUE(seg.pos == pos) << seg.pos << " != " << pos;
+        EXPECT_TRUE(seg.size() <= 4096) << seg.size();
+        EXPECT_TRUE(std::string(seg.begin(), seg.end()) == test_data.substr(pos, seg.size()));
+        pos += seg.size();
+    }
+    EXPECT_TRUE(pos == cnt.size()) << pos << " != " << cnt.size();
+
+    // The range crosses two window bounds.
+    pos = 4000;
+    for (const auto& seg : cnt.segments(4000, 5000)) {
+        EXPECT_TRUE(seg.pos == pos) << seg.pos << " != " << pos;
+        EXPECT_TRUE(std::string(seg.begin(), seg.end()) == test_data.substr(pos, seg.size()));
+        pos += seg.size();
+    }
+    EXPECT_TRUE(pos == 9000) << pos << " != " << 9000;
+
+    EXPECT_TRUE(cnt.segments(10, 0).begin() == cnt.segments(10, 0).end());
+}
+
+TYPED_TEST(mfcnt_fixture, algorithms)
+{
+    TypeParam cnt(this->test_file());
+    const std::string test_data = this->test_data();
+
+    const size_t sum = mfcnt::accumulate(cnt, size_t(0));
+    EXPECT_TRUE(sum == std::accumulate(test_data.begin(), test_data.end(), size_t(0)));
+
+    size_t sum_for_each = 0;
+    mfcnt::for_each(cnt, [&sum_for_each](char ch) { sum_for_each += ch; });
+    EXPECT_TRUE(sum_for_each == sum) << sum_for_each << " != " << sum;
+
+    const std::ptrdiff_t lines = mfcnt::count(cnt, '\n');
+    EXPECT_TRUE(lines == std::count(test_data.begin(), test_data.end(), '\n'));
+
+    const size_t h_pos = test_data.find('H');
+    typename TypeParam::const_iterator it = mfcnt::find(cnt, 'H');
+    EXPECT_TRUE(it - cnt.cbegin() == std::ptrdiff_t(h_pos)) << it - cnt.cbegin() << " != " << h_pos;
+    EXPECT_TRUE(*it == 'H');
+    EXPECT_TRUE(mfcnt::find(cnt, '#') == cnt.cend());
+    EXPECT_TRUE(mfcnt::find_if(cnt, [](char ch) { return ch == '!'; }) - cnt.cbegin() ==
+                std::ptrdiff_t(test_data.find('!')));
+    EXPECT_TRUE(mfcnt::count_if(cnt, [](char ch) { return ch == 'W'; }) ==
+                std::count(test_data.begin(), test_data.end(), 'W'));
+
+    const std::string set = "!?,";
+    EXPECT_TRUE(mfcnt::find_first_of(cnt, set.begin(), set.end()) - cnt.cbegin() ==
+                std::ptrdiff_t(test_data.find_first_of(set)));
+    const std::string no_set = "#$%";
+    EXPECT_TRUE(mfcnt::find_first_of(cnt, no_set.begin(), no_set.end()) == cnt.cend());
+
+    const std::string needle = "brick in the wall";
+    EXPECT_TRUE(mfcnt::search(cnt, needle.begin(), needle.end()) - cnt.cbegin() ==
+                std::ptrdiff_t(test_data.find(needle)));
+    const std::string no_needle = "brick in the classroom";
+    EXPECT_TRUE(mfcnt::search(cnt, no_needle.begin(), no_needle.end()) == cnt.cend());
+    EXPECT_TRUE(mfcnt::search(cnt, no_needle.begin(), no_needle.begin()) == cnt.cbegin());
+}
+
+TYPED_TEST(mfcnt_fixture, parallel_algorithms)
+{
+    const std::string test_data = this->test_data();
+    const size_t offset = 5000;
+
+    for (const size_t thread_count : {0, 1, 3, 8, 1000}) {
+        TypeParam cnt(this->test_file(), offset);
+
+        const size_t sum = mfcnt::parallel_reduce(cnt, size_t(0), [](char ch) { return size_t(ch); },
+                                                  std::plus<size_t>(), thread_count);
+        EXPECT_TRUE(sum == std::accumulate(test_data.begin() + offset, test_data.end(), size_t(0)))
+            << "thread_count: " << thread_count;
+
+        // The ranges are folded in their order, so a non-commutative operation gives the sequence.
+        const std::string str = mfcnt::parallel_reduce(cnt, std::string("#"),
+                                                       [](char ch) { return std::string(1, ch); },
+                                                       [](std::string lhs, const std::string& rhs) {
+                                                           lhs += rhs;
+                                                           return lhs;
+                                                       }, thread_count);
+        EXPECT_TRUE(str == "#" + test_data.substr(offset)) << "thread_count: " << thread_count;
+
+        std::atomic<size_t> lines(0);
+        mfcnt::parallel_for_each(cnt, [&lines](char ch) {
+            if (ch == '\n') {
+                lines.fetch_add(1, std::memory_order_relaxed);
+            }
+        }, thread_count);
+        EXPECT_TRUE(std::ptrdiff_t(lines.load()) == std::count(test_data.begin() + offset, test_data.end(), '\n'))
+            << "thread_count: " << thread_count;
+
+        TypeParam cnt_part(this->test_file(), 100, offset);
+        EXPECT_TRUE(cnt_part.window_first(99) == 0);
+        EXPECT_TRUE(mfcnt::parallel_reduce(cnt_part, size_t(0), [](char ch) { return size_t(ch); },
+                                           std::plus<size_t>(), thread_count) ==
+                    std::accumulate(test_data.begin() + offset, test_data.begin() + offset + 100, size_t(0)));
+    }
+
+    TypeParam cnt(this->test_file(), offset);
+    const size_t delta = offset % 4096;
+    EXPECT_TRUE(cnt.window_first(0) == 0);
+    EXPECT_TRUE(cnt.window_first(4096 - delta - 1) == 0);
+    EXPECT_TRUE(cnt.window_first(4096 - delta) == 4096 - delta);
+    EXPECT_TRUE(cnt.window_first(3 * 4096) == 3 * 4096 - delta);
+
+    TypeParam cnt_empty;
+    EXPECT_TRUE(mfcnt::parallel_reduce(cnt_empty, size_t(7), [](char ch) { return size_t(ch); },
+                                       std::plus<size_t>(), 4) == 7);
+    mfcnt::parallel_for_each(cnt_empty, [](char) {}, 4);
+}
+
+TYPED_TEST(mfcnt_fixture, advice)
+{
+    const std::string test_data = this->test_data();
+
+    TypeParam cnt(this->test_file(), 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::SEGMENTED,
+                  mfcnt::advice::SEQUENTIAL);
+    typename TypeParam::const_iterator it = cnt.cbegin();
+    for (const char ch : test_data) {
+        EXPECT_TRUE(ch == *it) << ch << " != " << *it;
+        ++it;
+    }
+
+    cnt.advise(mfcnt::advice::RANDOM);
+    cnt.advise(mfcnt::advice::WILLNEED, 4000, 5000);
+    for (size_t i = 0; i < test_data.size(); i += 4096 + 13) {
+        EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+    }
+
+    // Dropped pages of the read-only mapping are read again from the file.
+    TypeParam cnt_whole(this->test_file(), 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::WHOLE_FILE,
+                        mfcnt::advice::DONTNEED);
+    cnt_whole.advise(mfcnt::advice::DONTNEED, 100, 10000);
+    for (size_t i = 0; i < test_data.size(); i += 101) {
+        EXPECT_TRUE(cnt_whole[i] == test_data[i]) << cnt_whole[i] << " != " << test_data[i];
+    }
+}
+
+TYPED_TEST(mfcnt_fixture, eager_load)
+{
+    const std::string test_data = this->test_data();
+
+    for (const mfcnt::map_policy policy : {mfcnt::map_policy::SEGMENTED, mfcnt::map_policy::WHOLE_FILE,
+                                           mfcnt::map_policy::CONCURRENT}) {
+        for (const mfcnt::load_policy load : {mfcnt::load_policy::POPULATE, mfcnt::load_policy::PREFAULT}) {
+            TypeParam cnt(this->test_file(), 0, mfcnt::mode::R_ONLY, policy);
+            cnt.eager_load(load, 3);
+            cnt.eager_load(load);
+
+            typename TypeParam::const_iterator it = cnt.cbegin();
+            for (size_t i = 0; i < test_data.size(); ++i, ++it) {
+                EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+            }
+            for (size_t i = 0; i < test_data.size(); i += 4096 + 13) {
+                EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+            }
+        }
+    }
+
+    // The pages are locked if the limit of the process allows it.
+    struct ::rlimit limit;
+    ASSERT_TRUE(::getrlimit(RLIMIT_MEMLOCK, &limit) == 0);
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < 4 * test_data.size()) {
+        return;
+    }
+    for (const mfcnt::map_policy policy : {mfcnt::map_policy::SEGMENTED, mfcnt::map_policy::WHOLE_FILE}) {
+        TypeParam cnt(this->test_file(), 0, mfcnt::mode::R_ONLY, policy);
+        cnt.eager_load(mfcnt::load_policy::PREFAULT, 2, true);
+        EXPECT_TRUE(cnt[test_data.size() - 1] == test_data.back());
+        EXPECT_TRUE(*(cnt.cend() - 1) == test_data.back());
+    }
+}
+
+TYPED_TEST(mfcnt_fixture, huge_pages)
+{
+    const std::string test_data = this->test_data();
+
+    for (const mfcnt::map_policy policy : {mfcnt::map_policy::SEGMENTED, mfcnt::map_policy::WHOLE_FILE,
+                                           mfcnt::map_policy::CONCURRENT}) {
+        // The huge pages are combined with the access pattern and kept by its changes and the copies.
+        TypeParam orig(this->test_file(), 0, mfcnt::mode::R_ONLY, policy, mfcnt::advice::RANDOM,
+                       mfcnt::page_policy::HUGE_PAGES);
+        orig.advise(mfcnt::advice::SEQUENTIAL);
+        const TypeParam cnt(orig);
+        typename TypeParam::const_iterator it = cnt.cbegin();
+        EXPECT_TRUE(uintptr_t(&*it) % mfcnt::details::utils::kHugePageSize == 0) << (const void*)&*it;
+        for (size_t i = 0; i < test_data.size(); ++i, ++it) {
+            EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+        }
+        for (size_t i = 0; i < test_data.size(); i += 4096 + 13) {
+            EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+        }
+        EXPECT_TRUE(uintptr_t(&cnt[0]) % mfcnt::details::utils::kHugePageSize == 0) << (const void*)&cnt[0];
+    }
+}
+
+TYPED_TEST(mfcnt_fixture, stats)
+{
+    const std::string test_data = this->test_data();
+    TypeParam cnt(this->test_file());
+    cnt.set_window_count(2);
+    cnt.reset_stats();
+
+    // Cycle over more regions than windows, so each access remaps the least recently used window.
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_TRUE(cnt[0] == test_data[0]);
+        EXPECT_TRUE(cnt[4096] == test_data[4096]);
+        EXPECT_TRUE(cnt[2 * 4096] == test_data[2 * 4096]);
+    }
+    mfcnt::stats st = cnt.stats();
+    EXPECT_TRUE(st.hits == 0) << st.hits << " != 0";
+    EXPECT_TRUE(st.misses == 300) << st.misses << " != 300";
+    EXPECT_TRUE(st.remaps == 300) << st.remaps << " != 300";
+    EXPECT_TRUE(st.unmaps == 298) << st.unmaps << " != 298";
+    EXPECT_TRUE(st.mapped_bytes == 300 * 4096) << st.mapped_bytes << " != " << 300 * 4096;
+    EXPECT_TRUE(st.syscall_nsecs > 0);
+    EXPECT_TRUE(st.hit_ratio() == 0.0) << st.hit_ratio() << " != 0";
+
+    cnt.set_window_count(3);
+    cnt.reset_stats();
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_TRUE(cnt[0] == test_data[0]);
+        EXPECT_TRUE(cnt[4096] == test_data[4096]);
+        EXPECT_TRUE(cnt[2 * 4096] == test_data[2 * 4096]);
+    }
+    st = cnt.stats();
+    EXPECT_TRUE(st.hits == 297) << st.hits << " != 297";
+    EXPECT_TRUE(st.misses == 3) << st.misses << " != 3";
+    EXPECT_TRUE(st.unmaps == 0) << st.unmaps << " != 0";
+    EXPECT_TRUE(st.hit_ratio() == 0.99) << st.hit_ratio() << " != 0.99";
+
+    cnt.reset_stats();
+    typename TypeParam::const_iterator it = cnt.cbegin();
+    for (size_t i = 0; i < test_data.size(); ++i, ++it) {
+        EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+    }
+    st = cnt.stats();
+    EXPECT_TRUE(st.misses > 0);
+    EXPECT_TRUE(st.remaps == st.misses) << st.remaps << " != " << st.misses;
+    EXPECT_TRUE(st.minor_faults + st.major_faults > 0);
+
+    TypeParam cnt_copy(cnt);
+    st = cnt_copy.stats();
+    EXPECT_TRUE(st.hits == 0 && st.misses == 0);
+
+    // The units built without MFCNT_STATS, e.g. perf_mfcnt, use the other types of the containers.
+    static_assert(std::is_same<TypeParam, mfcnt::stats_on::mmap_deque_view<char, 4096>>::value
+                      || std::is_same<TypeParam, mfcnt::stats_on::mmap_list_view<char, 4096>>::value,
+                  "the containers are declared in the inline namespace of the counters");
+}
+
 TYPED_TEST(mfcnt_fixture, test_1)
 {
     TypeParam cnt(this->test_file());
@@ -411,6 +798,1035 @@ TYPED_TEST(mfcnt_fixture, DISABLED_iterators)
     }
 }
 
+TEST(mfcnt, search_across_windows)
+{
+    // Substrings of the random letters are unique, so the needles are found at their positions only.
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist('a', 'z');
+    std::string data(64 * 1024, ' ');
+    for (char& ch : data) {
+        ch = char(dist(gen));
+    }
+    const std::string file = (mfcnt_env::test_file().parent_path() / "random_file").string();
+    {
+        std::ofstream fout(file, std::ios::binary);
+        fout << data;
+    }
+
+    const mfcnt::mmap_deque_view<char, 4096> deque_cnt(file);
+    const mfcnt::mmap_list_view<char, 4096> list_cnt(file);
+    for (const std::pair<size_t, size_t> needle_range : {std::make_pair(4090, 16), std::make_pair(2 * 4096 - 1, 2),
+                                                          std::make_pair(5 * 4096 - 20, 40), std::make_pair(0, 20),
+                                                          std::make_pair(4000, 5000), std::make_pair(9000, 9000),
+                                                          std::make_pair(64 * 1024 - 7, 7)}) {
+        const std::string needle = data.substr(needle_range.first, needle_range.second);
+        const size_t expected = data.find(needle);
+        const std::ptrdiff_t deque_pos = mfcnt::search(deque_cnt, needle.begin(), needle.end()) - deque_cnt.cbegin();
+        EXPECT_TRUE(deque_pos == std::ptrdiff_t(expected)) << deque_pos << " != " << expected;
+        const std::ptrdiff_t list_pos = mfcnt::search(list_cnt, needle.begin(), needle.end()) - list_cnt.cbegin();
+        EXPECT_TRUE(list_pos == std::ptrdiff_t(expected)) << list_pos << " != " << expected;
+    }
+
+    const std::string tail = data.substr(data.size() - 7) + "a";
+    EXPECT_TRUE(mfcnt::search(deque_cnt, tail.begin(), tail.end()) == deque_cnt.cend());
+}
+
+TEST(mfcnt, simd_kernels)
+{
+    namespace simd = mfcnt::details::simd;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 3);
+    std::string data(4096, ' ');
+    for (char& ch : data) {
+        ch = "ab\n\xff"[dist(gen)];
+    }
+
+    const std::string sets[] = {"", "\n", "b\xff", "0123456789ABCDEFb", std::string(1, '\0')};
+    const std::string needles[] = {"a", "ab", "\nab", "abab\xff", "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"};
+    for (size_t first = 0; first < 33; ++first) {
+        for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100, 255 * 32 / 4, 4000}) {
+            length = std::min(length, data.size() - first);
+            const char* p_first = data.data() + first;
+            const char* p_last = p_first + length;
+
+            for (const char value : {'a', '\n', '\xff', 'x'}) {
+                const size_t expected = std::count(p_first, p_last, value);
+                EXPECT_TRUE(simd::count(p_first, p_last, value) == expected);
+                EXPECT_TRUE(simd::count_scalar(p_first, p_last, value) == expected);
+                EXPECT_TRUE(simd::find(p_first, p_last, value) == std::find(p_first, p_last, value));
+#ifdef MFCNT_SIMD_X86
+                EXPECT_TRUE(simd::count_sse2(p_first, p_last, value) == expected);
+                if (simd::has_avx2()) {
+                    EXPECT_TRUE(simd::count_avx2(p_first, p_last, value) == expected);
+                }
+#endif
+            }
+
+            for (const std::string& set : sets) {
+                const char* p_expected = std::find_first_of(p_first, p_last, set.begin(), set.end());
+                EXPECT_TRUE(simd::find_first_of(p_first, p_last, set.data(), set.size()) == p_expected);
+                EXPECT_TRUE(simd::find_first_of_scalar(p_first, p_last, set.data(), set.size()) == p_expected);
+#ifdef MFCNT_SIMD_X86
+                EXPECT_TRUE(simd::find_first_of_sse2(p_first, p_last, set.data(), set.size()) == p_expected);
+                if (simd::has_avx2()) {
+                    EXPECT_TRUE(simd::find_first_of_avx2(p_first, p_last, set.data(), set.size()) == p_expected);
+                }
+#endif
+            }
+
+            for (const std::string& needle : needles) {
+                const char* p_expected = std::search(p_first, p_last, needle.begin(), needle.end());
+                EXPECT_TRUE(simd::search(p_first, p_last, needle.data(), needle.size()) == p_expected);
+                EXPECT_TRUE(simd::search_scalar(p_first, p_last, needle.data(), needle.size()) == p_expected);
+#ifdef MFCNT_SIMD_X86
+                EXPECT_TRUE(simd::search_sse2(p_first, p_last, needle.data(), needle.size()) == p_expected);
+                if (simd::has_avx2()) {
+                    EXPECT_TRUE(simd::search_avx2(p_first, p_last, needle.data(), needle.size()) == p_expected);
+                }
+#endif
+            }
+        }
+    }
+}
+
+TEST(mfcnt, prefetch)
+{
+    using cnt_t = mfcnt::mmap_deque_view<char, 4096>;
+
+    const std::string test_data = mfcnt_env::test_data();
+    for (const double fraction : {0.0, 0.001, 0.5, 1.0}) {
+        cnt_t cnt(mfcnt_env::test_file().string());
+        cnt.set_prefetch(fraction);
+
+        size_t i = 0;
+        const cnt_t::const_iterator end_it = cnt.cend();
+        for (cnt_t::const_iterator it = cnt.cbegin(); it != end_it; ++it, ++i) {
+            EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+        }
+        EXPECT_TRUE(i == test_data.size()) << i << " != " << test_data.size();
+
+        // Jump over the read-ahead point and go on sequentially.
+        cnt_t::const_iterator it = cnt.cbegin() + 10;
+        it += 3000;
+        for (i = 3010; i < 3 * 4096; ++i, ++it) {
+            EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+        }
+        for (; i > 2 * 4096; --i) {
+            --it;
+        }
+        for (; i < 3 * 4096; ++i, ++it) {
+            EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+        }
+    }
+}
+
+TEST(mfcnt, concurrent_readers)
+{
+    using cnt_t = mfcnt::mmap_list_view<char, 4096>;
+
+    const std::string test_data = mfcnt_env::test_data();
+    const cnt_t cnt(mfcnt_env::test_file().string(), 0, mfcnt::mode::R_ONLY,
+                    mfcnt::map_policy::CONCURRENT);
+    ASSERT_TRUE(cnt.size() == test_data.size()) << cnt.size() << " != " << test_data.size();
+
+    constexpr size_t kThreadCount = 4;
+    std::vector<size_t> errors(kThreadCount, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([&cnt, &test_data, &errors, t]() {
+            // Each thread starts from its own part of the file and wraps around.
+            const size_t first = t * test_data.size() / kThreadCount;
+            size_t i = first;
+            for (cnt_t::const_iterator it = cnt.cbegin() + first; it != cnt.cend(); ++it, ++i) {
+                errors[t] += (*it != test_data[i]) ? 1 : 0;
+            }
+            for (i = 0; i < first; ++i) {
+                errors[t] += (cnt[i] != test_data[i]) ? 1 : 0;
+            }
+            // Random access over the whole range.
+            size_t pos = t;
+            for (i = 0; i < 10000; ++i) {
+                pos = (pos * 6364136223846793005ULL + 1442695040888963407ULL) % test_data.size();
+                errors[t] += (cnt[pos] != test_data[pos]) ? 1 : 0;
+            }
+        });
+    }
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    for (size_t t = 0; t < kThreadCount; ++t) {
+        EXPECT_TRUE(errors[t] == 0) << "thread " << t << ": " << errors[t] << " mismatches";
+    }
+
+    // Deque iterators use the shared windows too.
+    using deque_t = mfcnt::mmap_deque_view<char, 4096>;
+    const deque_t deque(mfcnt_env::test_file().string(), 0, mfcnt::mode::R_ONLY,
+                        mfcnt::map_policy::CONCURRENT);
+    size_t i = 0;
+    const deque_t::const_iterator end_it = deque.cend();
+    for (deque_t::const_iterator it = deque.cbegin(); it != end_it; ++it, ++i) {
+        EXPECT_TRUE(*it == test_data[i]) << *it << " != " << test_data[i];
+    }
+    EXPECT_TRUE(i == test_data.size()) << i << " != " << test_data.size();
+}
+
+TEST(mfcnt, deque_iterator_copy)
+{
+    using cnt_t = mfcnt::mmap_deque_view<char, 4096>;
+    static_assert(std::is_trivially_copyable<cnt_t::const_iterator>::value,
+                  "deque iterator must be trivially copyable");
+
+    const std::string test_data = mfcnt_env::test_data();
+    cnt_t cnt(mfcnt_env::test_file().string());
+    cnt.set_window_count(1);
+
+    // Windows of the iterators outlive the windows of the cache.
+    const cnt_t::const_iterator first = cnt.cbegin() + 5;
+    const cnt_t::const_iterator last = cnt.cend() - 5;
+    for (size_t i = 0; i < test_data.size(); i += 4096) {
+        EXPECT_TRUE(cnt[i] == test_data[i]) << cnt[i] << " != " << test_data[i];
+    }
+    EXPECT_TRUE(*first == test_data[5]) << *first << " != " << test_data[5];
+    EXPECT_TRUE(*last == test_data[test_data.size() - 5]) << *last << " != " << test_data[test_data.size() - 5];
+
+    // Binary search creates a lot of short-lived copies.
+    const cnt_t::const_iterator begin_it = cnt.cbegin();
+    for (size_t pos = 0; pos < test_data.size(); pos += 12345) {
+        size_t lo = 0;
+        size_t hi = test_data.size();
+        while (hi - lo > 1) {
+            const size_t mid = lo + (hi - lo) / 2;
+            cnt_t::const_iterator it = begin_it;
+            it += mid;
+            EXPECT_TRUE(*it == test_data[mid]) << *it << " != " << test_data[mid];
+            (mid <= pos) ? (lo = mid) : (hi = mid);
+        }
+        EXPECT_TRUE(lo == pos) << lo << " != " << pos;
+    }
+}
+
+TEST(mfcnt, deque_iterator_bounded_mappings)
+{
+    namespace utils = mfcnt::details::utils;
+    using cnt_t = mfcnt::mmap_deque_view<char, 4096>;
+
+    // The sparse file of more chunks than are kept mapped.
+    const size_t chunk_count = 3 * utils::kLiveChunkCount;
+    const std::string file = (mfcnt_env::test_file().parent_path() / "bounded_file").string();
+    std::filesystem::remove(file);
+    std::ofstream(file).close();
+    std::filesystem::resize_file(file, chunk_count * utils::kChunkSize);
+
+    {
+        cnt_t cnt(file);
+        const cnt_t::const_iterator first = cnt.cbegin() + 7;
+        const cnt_t::const_iterator first_copy = first;
+        const size_t base = cnt.stats().remaps;
+
+        // Step over the chunks, so each chunk is mapped once.
+        size_t max_live = 0;
+        cnt_t::const_iterator it = cnt.cbegin();
+        for (size_t i = 0; i < chunk_count; ++i, it += utils::kChunkSize) {
+            EXPECT_TRUE(*it == 0) << "chunk " << i;
+            const mfcnt::stats st = cnt.stats();
+            max_live = std::max(max_live, st.remaps - base - st.unmaps);
+        }
+        EXPECT_TRUE(max_live <= utils::kLiveChunkCount) << max_live << " live chunks";
+
+        // The iterators map their chunk again after it has been unmapped.
+        const size_t unmaps = cnt.stats().unmaps;
+        EXPECT_TRUE(unmaps > 0);
+        EXPECT_TRUE(*first == 0 && *first_copy == 0);
+        EXPECT_TRUE(&*first == &*first_copy);
+        EXPECT_TRUE(first - cnt.cbegin() == 7);
+        EXPECT_TRUE(cnt.stats().remaps - base - cnt.stats().unmaps <= utils::kLiveChunkCount);
+
+        for (const mfcnt::load_policy load : {mfcnt::load_policy::POPULATE, mfcnt::load_policy::PREFAULT}) {
+            cnt.eager_load(load, 2);
+            const mfcnt::stats st = cnt.stats();
+            EXPECT_TRUE(st.remaps - base - st.unmaps <= utils::kLiveChunkCount)
+                << st.remaps - base - st.unmaps << " live chunks after the load";
+        }
+    }
+
+    // The concurrent container keeps the chunks mapped until it is closed.
+    {
+        cnt_t cnt(file, 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::CONCURRENT);
+        size_t count = 0;
+        for (cnt_t::const_iterator it = cnt.cbegin(); it != cnt.cend(); it += utils::kChunkSize) {
+            count += (*it == 0);
+        }
+        EXPECT_TRUE(count == chunk_count) << count << " != " << chunk_count;
+        EXPECT_TRUE(cnt.stats().unmaps == 0) << cnt.stats().unmaps;
+        EXPECT_TRUE(cnt.data() == nullptr);
+    }
+
+    // The larger concurrent range is mapped whole, so the chunks do not exhaust the mappings.
+    std::filesystem::resize_file(file, utils::kMaxConcurrentChunkCount * utils::kChunkSize + 4096);
+    {
+        const cnt_t cnt(file, 0, mfcnt::mode::R_ONLY, mfcnt::map_policy::CONCURRENT);
+        ASSERT_TRUE(cnt.data() != nullptr);
+        EXPECT_TRUE(cnt.contiguous().size() == cnt.size()) << cnt.contiguous().size() << " != " << cnt.size();
+        const size_t base = cnt.stats().remaps;
+        size_t count = 0;
+        for (cnt_t::const_iterator it = cnt.cbegin(); it < cnt.cend(); it += 1024 * utils::kChunkSize) {
+            count += (*it == 0);
+        }
+        EXPECT_TRUE(count == 17) << count;
+        EXPECT_TRUE(cnt.back() == 0);
+        EXPECT_TRUE(cnt.stats().remaps == base) << cnt.stats().remaps << " != " << base;
+    }
+
+    std::filesystem::remove(file);
+}
+
+TEST(mfcnt, mmap_aligned)
+{
+    namespace utils = mfcnt::details::utils;
+
+    const int fd = ::open(mfcnt_env::test_file().c_str(), O_RDONLY);
+    ASSERT_TRUE(fd != -1);
+
+    const size_t page_size = utils::memory_page_size();
+    for (const size_t offset : {size_t(0), page_size, 3 * page_size}) {
+        const size_t length = 5 * page_size + 1;
+        char* p_buf = (char*)utils::mmap_aligned(length, PROT_READ, MAP_SHARED, fd, offset, utils::kHugePageSize);
+        ASSERT_TRUE(p_buf != MAP_FAILED);
+        EXPECT_TRUE(size_t(p_buf) % utils::kHugePageSize == offset)
+            << size_t(p_buf) % utils::kHugePageSize << " != " << offset;
+        EXPECT_TRUE(p_buf[0] == mfcnt_env::test_data()[offset]);
+        EXPECT_TRUE(::munmap(p_buf, length) == 0);
+    }
+    ::close(fd);
+}
+
+TEST(mfcnt, records)
+{
+    using deque_t = mfcnt::mmap_deque_view<record, 1000>;
+    using list_t = mfcnt::mmap_list_view<record, 1000>;
+    using geometry_t = mfcnt::details::utils::window_geometry<record, 1000>;
+
+    // Window of 1000 24-byte records is rounded up to 1024 records.
+    EXPECT_TRUE(geometry_t::count == 1024);
+    EXPECT_TRUE(geometry_t::shift == 10);
+
+    const size_t count = 10000;
+    const size_t first = 171;   // The offset is not aligned with the memory page.
+    const std::string file = create_records_file(count);
+
+    check_records(deque_t(file, first * sizeof(record)), first, count - first);
+    check_records(list_t(file, first * sizeof(record)), first, count - first);
+    check_records(deque_t(file, first * sizeof(record), mfcnt::mode::R_ONLY, mfcnt::map_policy::WHOLE_FILE),
+                  first, count - first);
+    check_records(list_t(file, 100 * sizeof(record), first * sizeof(record)), first, 100);
+
+    // The offset is neither a multiple of the record size nor reachable from the page boundary.
+    EXPECT_THROW(deque_t(file, 100 * sizeof(record), 10), std::runtime_error);
+}
+
+TEST(mfcnt, vector)
+{
+    using vector_t = mfcnt::mmap_vector<record>;
+
+    const std::string file = (mfcnt_env::test_file().parent_path() / "vector_file").string();
+    std::filesystem::remove(file);
+
+    const size_t count = 10000;
+    {
+        vector_t vec(file);
+        EXPECT_TRUE(vec.empty());
+        for (size_t i = 0; i < count; ++i) {
+            vec.push_back(record{i, i * 2, i});
+        }
+        ASSERT_TRUE(vec.size() == count) << vec.size() << " != " << count;
+        EXPECT_TRUE(vec.capacity() >= count) << vec.capacity() << " < " << count;
+
+        for (record& r : vec) {
+            r.value *= 3;
+        }
+        EXPECT_TRUE(vec.back().id == count - 1) << vec.back().id << " != " << count - 1;
+        EXPECT_THROW(vec.at(count), std::runtime_error);
+    }
+    // The size of the file is set to the size of the container.
+    EXPECT_TRUE(std::filesystem::file_size(file) == count * sizeof(record))
+        << std::filesystem::file_size(file) << " != " << count * sizeof(record);
+    check_records(mfcnt::mmap_deque_view<record, 1024>(file), 0, count);
+
+    {
+        vector_t vec(file);
+        ASSERT_TRUE(vec.size() == count) << vec.size() << " != " << count;
+        EXPECT_TRUE(vec.capacity() == count) << vec.capacity() << " != " << count;
+
+        vec.resize(count / 2);
+        vec.shrink_to_fit();
+        EXPECT_TRUE(vec.capacity() == count / 2) << vec.capacity() << " != " << count / 2;
+        EXPECT_TRUE(std::filesystem::file_size(file) == count / 2 * sizeof(record))
+            << std::filesystem::file_size(file) << " != " << count / 2 * sizeof(record);
+
+        vec.reserve(count);
+        EXPECT_TRUE(vec.capacity() == count) << vec.capacity() << " != " << count;
+        vec.resize(count, record{0, 0, 0});
+        for (size_t i = count / 2; i < count; ++i) {
+            EXPECT_TRUE(vec[i].id == 0) << vec[i].id << " != 0";
+            vec[i] = record{i, i * 2, i * 3};
+        }
+        // The element of the container is appended while the capacity grows.
+        vec.push_back(vec[0]);
+        EXPECT_TRUE(vec.back().id == 0) << vec.back().id << " != 0";
+        vec.pop_back();
+
+        vector_t moved(std::move(vec));
+        EXPECT_TRUE(moved.size() == count) << moved.size() << " != " << count;
+    }
+    check_records(mfcnt::mmap_list_view<record, 1024>(file), 0, count);
+
+    // The view is writable in the shared mode.
+    const mfcnt::mmap_deque_view<record, 1024> view(file, 0, mfcnt::mode::RW_SHARED);
+    EXPECT_TRUE(view.size() == count) << view.size() << " != " << count;
+}
+
+TEST(mfcnt, vector_flush)
+{
+    using vector_t = mfcnt::mmap_vector<record>;
+
+    const std::string file = (mfcnt_env::test_file().parent_path() / "vector_flush_file").string();
+    std::filesystem::remove(file);
+
+    // Several tracked regions of 2 MiB.
+    const size_t count = 300000;
+    vector_t vec(file);
+    vec.resize(count);
+    vec.sync();
+
+    const vector_t& cvec = vec;
+    for (size_t i = 0; i < count; i += 1000) {
+        vec[i] = record{i, i * 2, i * 3};
+    }
+    vec.flush_async();
+    vec.flush_async(0, 100);
+    vec.flush(count / 2, count / 4);
+    vec.sync();
+    vec.sync();
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t id = (i % 1000 == 0) ? i : 0;
+        EXPECT_TRUE(cvec[i].id == id) << cvec[i].id << " != " << id;
+    }
+
+    // Writes through the pointers are flushed as well.
+    std::fill(vec.begin(), vec.end(), record{1, 2, 3});
+    vec.sync();
+
+    std::ifstream fin(file, std::ios::binary);
+    record r = {0, 0, 0};
+    fin.seekg((count - 1) * sizeof(record));
+    fin.read(reinterpret_cast<char*>(&r), sizeof(r));
+    EXPECT_TRUE(r.id == 1 && r.value == 3) << r.id << " " << r.value;
+}
+
+TEST(mfcnt, line_index)
+{
+    const auto split = [](const std::string& data) {
+        std::vector<std::string> lines;
+        size_t first = 0;
+        for (size_t pos = data.find('\n'); pos != std::string::npos; pos = data.find('\n', first)) {
+            lines.push_back(data.substr(first, pos - first));
+            first = pos + 1;
+        }
+        if (first < data.size()) {
+            lines.push_back(data.substr(first));
+        }
+        return lines;
+    };
+    const auto check = [](const mfcnt::mmap_line_index& index, const std::vector<std::string>& lines) {
+        ASSERT_TRUE(index.size() == lines.size()) << index.size() << " != " << lines.size();
+        for (size_t k = 0; k < lines.size(); ++k) {
+            const mfcnt::mmap_line_index::line_type line = index.line(k);
+            ASSERT_TRUE(std::string(line.begin(), line.end()) == lines[k]) << "line " << k;
+        }
+    };
+
+    const std::filesystem::path dir = mfcnt_env::test_file().parent_path();
+    const std::string file = (dir / "lines_file").string();
+    std::filesystem::remove(file + ".lidx");
+    std::filesystem::copy_file(mfcnt_env::test_file(), file, std::filesystem::copy_options::overwrite_existing);
+
+    std::string data = mfcnt_env::test_data();
+    {
+        const mfcnt::mmap_line_index index(file, 3);
+        EXPECT_TRUE(index.index_path() == file + ".lidx");
+        EXPECT_TRUE(index.indexed_size() == data.size()) << index.indexed_size() << " != " << data.size();
+        check(index, split(data));
+    }
+
+    // The appended data is indexed, the old offsets are kept.
+    const std::string tail = "\ntail\n\nunterminated";
+    {
+        std::ofstream fout(file, std::ios::binary | std::ios::app);
+        fout << tail;
+    }
+    data += tail;
+    mfcnt::mmap_line_index index(file, 2);
+    check(index, split(data));
+    EXPECT_TRUE(index.line(index.size() - 1).pos == data.size() - 12);
+
+    // The index of the unchanged file is reused.
+    const auto index_time = std::filesystem::last_write_time(file + ".lidx");
+    index.update();
+    EXPECT_TRUE(std::filesystem::last_write_time(file + ".lidx") == index_time);
+    check(index, split(data));
+
+    // The torn header fails the checksum, so the index is rebuilt.
+    {
+        std::fstream fout(file + ".lidx", std::ios::binary | std::ios::in | std::ios::out);
+        const uint64_t newlines = 1;
+        fout.seekp(2 * sizeof(uint64_t));
+        fout.write(reinterpret_cast<const char*>(&newlines), sizeof(newlines));
+    }
+    index.update();
+    check(index, split(data));
+
+    // The index of the truncated file is rebuilt.
+    data.resize(data.size() / 3);
+    std::filesystem::resize_file(file, data.size());
+    index.update(4);
+    check(index, split(data));
+
+    std::filesystem::resize_file(file, 0);
+    index.update();
+    EXPECT_TRUE(index.empty());
+}
+
+TEST(mfcnt, record_view)
+{
+    using view_t = mfcnt::mmap_record_view<uint32_t, 4096>;
+    static_assert(std::is_same<view_t::const_iterator::iterator_category, std::input_iterator_tag>::value,
+                  "records point into the windows, so the iterator is single pass");
+
+    // Records of random lengths, some of them are longer than the window.
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint32_t> dist(0, 600);
+    std::vector<std::string> payloads;
+    std::string data;
+    for (size_t i = 0; i < 2000; ++i) {
+        const uint32_t length = (i % 100 == 99) ? 10000 + i : dist(gen);
+        std::string payload(length, ' ');
+        for (size_t j = 0; j < length; ++j) {
+            payload[j] = char('a' + (i + j) % 26);
+        }
+        data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        data += payload;
+        payloads.push_back(payload);
+    }
+    const std::string file = (mfcnt_env::test_file().parent_path() / "length_prefixed_file").string();
+    {
+        std::ofstream fout(file, std::ios::binary);
+        fout << data;
+    }
+
+    view_t view(file);
+    EXPECT_TRUE(view.bytes() == data.size()) << view.bytes() << " != " << data.size();
+    EXPECT_FALSE(view.indexed());
+
+    size_t i = 0;
+    size_t copied = 0;
+    for (const mfcnt::mmap_record& rec : view) {
+        ASSERT_TRUE(i < payloads.size());
+        EXPECT_TRUE(std::string(rec.begin(), rec.end()) == payloads[i]) << "record " << i;
+        EXPECT_TRUE(rec.copied() == (rec.pos() / 4096 != (rec.pos() + rec.size() - 1) / 4096 && ! rec.empty()))
+            << "record " << i;
+        copied += rec.copied() ? 1 : 0;
+        ++i;
+    }
+    EXPECT_TRUE(i == payloads.size()) << i << " != " << payloads.size();
+    EXPECT_TRUE(copied > 0 && copied < payloads.size() / 2) << copied;
+
+    view.build_index();
+    ASSERT_TRUE(view.indexed());
+    ASSERT_TRUE(view.size() == payloads.size()) << view.size() << " != " << payloads.size();
+    for (size_t k = payloads.size(); k-- > 0; ) {
+        const mfcnt::mmap_record rec = view[k];
+        EXPECT_TRUE(std::string(rec.begin(), rec.end()) == payloads[k]) << "record " << k;
+    }
+    EXPECT_THROW(view.at(payloads.size()), std::out_of_range);
+
+    // The view with the offset starts at the second record.
+    const view_t tail(file, sizeof(uint32_t) + payloads[0].size());
+    EXPECT_TRUE(std::string(tail.begin()->begin(), tail.begin()->end()) == payloads[1]);
+
+    // The length of the last record exceeds the file.
+    const view_t truncated(file, data.size() - 1, 0);
+    view_t::const_iterator it = truncated.cbegin();
+    EXPECT_THROW(std::advance(it, payloads.size() - 1), std::runtime_error);
+    EXPECT_THROW(view_t(file, data.size() - 1, 0).build_index(), std::runtime_error);
+}
+
+TEST(mfcnt, sorted_view)
+{
+    // Sorted keys with the gaps and the runs of the equal keys.
+    const size_t count = 100000;
+    std::vector<uint64_t> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = (i / 3) * 5 + 10;
+    }
+    const std::string file = (mfcnt_env::test_file().parent_path() / "sorted_file").string();
+    {
+        std::ofstream fout(file, std::ios::binary);
+        fout.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+    }
+
+    const auto check = [](const auto& view, const uint64_t* p_first, const uint64_t* p_last) {
+        ASSERT_TRUE(view.size() == size_t(p_last - p_first)) << view.size() << " != " << p_last - p_first;
+        for (uint64_t key = 0; key < *(p_last - 1) + 20; key += 2) {
+            const size_t lower = std::lower_bound(p_first, p_last, key) - p_first;
+            const size_t upper = std::upper_bound(p_first, p_last, key) - p_first;
+            ASSERT_TRUE(view.lower_bound(key) == lower) << key << ": " << view.lower_bound(key) << " != " << lower;
+            ASSERT_TRUE(view.upper_bound(key) == upper) << key << ": " << view.upper_bound(key) << " != " << upper;
+            EXPECT_TRUE(view.contains(key) == (lower != upper)) << key;
+        }
+    };
+
+    // The window of 8 pages is mapped once per lookup.
+    using view_t = mfcnt::mmap_sorted_view<uint64_t, std::less<uint64_t>, 4096>;
+    view_t view(file);
+    EXPECT_TRUE(view.block() * sizeof(uint64_t) == size_t(mfcnt::details::utils::memory_page_size()));
+    check(view, keys.data(), keys.data() + count);
+    view.reset_stats();
+    for (size_t i = 0; i < 100; ++i) {
+        view.lower_bound(keys[(i * 7919) % count]);
+    }
+    EXPECT_TRUE(view.stats().remaps <= 100) << view.stats().remaps;
+
+    // The blocks cross the windows if the offset of the view is not aligned with the block.
+    check(view_t(file, (count - 5) * sizeof(uint64_t), 5 * sizeof(uint64_t), 7), keys.data() + 5,
+          keys.data() + count);
+    check(view_t(file, 1000 * sizeof(uint64_t), 17 * sizeof(uint64_t), 300), keys.data() + 17,
+          keys.data() + 1017);
+
+    const std::pair<size_t, size_t> range = view.equal_range(15);
+    EXPECT_TRUE(range.first == 3 && range.second == 6) << range.first << " " << range.second;
+    EXPECT_TRUE(view.find(12) == view.size());
+    EXPECT_TRUE(view.find(15) == 3);
+    EXPECT_TRUE(view.lower_bound(0) == 0 && view.upper_bound(1000000000) == view.size());
+}
+
+TEST(mfcnt, static_hash_map)
+{
+    using map_t = mfcnt::mmap_static_hash_map<uint64_t, record>;
+
+    const std::string file = (mfcnt_env::test_file().parent_path() / "static_hash_file").string();
+    const size_t count = 100000;
+    std::vector<std::pair<uint64_t, record>> elements;
+    for (size_t i = 0; i < count; ++i) {
+        elements.emplace_back(i * 7 + 3, record{i, i * 2, i * 3});
+    }
+    map_t::build(file, elements.begin(), elements.end());
+
+    for (const mfcnt::map_policy policy : {mfcnt::map_policy::WHOLE_FILE, mfcnt::map_policy::SEGMENTED}) {
+        const map_t map(file, policy);
+        ASSERT_TRUE(map.size() == count) << map.size() << " != " << count;
+        EXPECT_TRUE(map.load_factor() > 0.25 && map.load_factor() <= 0.5) << map.load_factor();
+        for (size_t i = 0; i < count; ++i) {
+            const record* p_value = map.find(i * 7 + 3);
+            ASSERT_TRUE(p_value != nullptr) << "key " << i * 7 + 3;
+            EXPECT_TRUE(p_value->id == i && p_value->value == i * 3) << p_value->id << " != " << i;
+            EXPECT_FALSE(map.contains(i * 7 + 4)) << "key " << i * 7 + 4;
+        }
+        EXPECT_THROW(map.at(1), std::out_of_range);
+    }
+
+    // The keys of any size, the map of the other types is not opened.
+    using name_t = std::array<char, 12>;
+    using names_t = mfcnt::mmap_static_hash_map<name_t, uint32_t>;
+    std::vector<std::pair<name_t, uint32_t>> names;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        name_t name = {};
+        std::snprintf(name.data(), name.size(), "name_%u", i);
+        names.emplace_back(name, i);
+    }
+    names_t::build(file, names.begin(), names.end(), 0.9);
+    const names_t names_map(file);
+    EXPECT_TRUE(names_map.load_factor() <= 0.9) << names_map.load_factor();
+    for (const std::pair<name_t, uint32_t>& name : names) {
+        EXPECT_TRUE(names_map.at(name.first) == name.second) << name.first.data();
+    }
+    EXPECT_THROW(map_t{file}, std::runtime_error);
+
+    names.push_back(names.front());
+    EXPECT_THROW(names_t::build(file, names.begin(), names.end()), std::runtime_error);
+    EXPECT_FALSE(std::filesystem::exists(file + ".tmp"));
+    EXPECT_TRUE(names_t(file).size() == 1000) << names_t(file).size();
+
+    // The file is replaced, the map opened before keeps the old table.
+    names_t::build(file, names.begin(), names.begin());
+    EXPECT_TRUE(names_t(file).empty());
+    EXPECT_TRUE(names_map.size() == 1000) << names_map.size();
+    EXPECT_TRUE(names_map.at(names.back().first) == 0);
+    EXPECT_FALSE(names_t(file).contains(names.front().first));
+}
+
+TEST(mfcnt, concurrent_hash_map)
+{
+    using map_t = mfcnt::mmap_concurrent_hash_map<uint64_t, int64_t>;
+
+    const std::string file = (mfcnt_env::test_file().parent_path() / "concurrent_hash_file").string();
+    const size_t key_count = 1000;
+    const size_t process_count = 3;
+    const size_t thread_count = 4;
+    map_t::create(file, 3000);
+
+    // The processes and their threads increment the same counters.
+    std::vector<pid_t> children;
+    for (size_t p = 0; p < process_count; ++p) {
+        const pid_t pid = ::fork();
+        ASSERT_TRUE(pid != -1);
+        if (pid == 0) {
+            map_t map(file);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < thread_count; ++t) {
+                threads.emplace_back([&map, key_count]() {
+                    for (size_t i = 0; i < 10 * key_count; ++i) {
+                        map.fetch_add(i % key_count, 1);
+                    }
+                });
+            }
+            for (std::thread& th : threads) {
+                th.join();
+            }
+            ::_exit(0);
+        }
+        children.push_back(pid);
+    }
+    for (const pid_t pid : children) {
+        int status = 0;
+        ASSERT_TRUE(::waitpid(pid, &status, 0) == pid);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << status;
+    }
+
+    map_t map(file);
+    EXPECT_TRUE(map.capacity() == 4096) << map.capacity();
+    ASSERT_TRUE(map.size() == key_count) << map.size() << " != " << key_count;
+    for (size_t i = 0; i < key_count; ++i) {
+        int64_t value = 0;
+        ASSERT_TRUE(map.find(i, value)) << "key " << i;
+        EXPECT_TRUE(value == int64_t(10 * process_count * thread_count)) << "key " << i << ": " << value;
+    }
+
+    EXPECT_FALSE(map.insert(5, 100));
+    EXPECT_TRUE(map.insert(5000, -7));
+    EXPECT_TRUE(map.fetch_add(5000, -3) == -7);
+    EXPECT_FALSE(map.insert_or_assign(5000, 42));
+    int64_t expected = 41;
+    EXPECT_FALSE(map.compare_exchange(5000, expected, 1));
+    EXPECT_TRUE(expected == 42) << expected;
+    EXPECT_TRUE(map.compare_exchange(5000, expected, 1));
+    EXPECT_FALSE(map.compare_exchange(5001, expected, 1));
+    EXPECT_FALSE(map.contains(5001));
+    EXPECT_THROW(map.insert(~uint64_t(0), 1), std::runtime_error);
+
+    // The full map is grown offline.
+    for (size_t i = key_count + 1; map.size() < map.capacity(); ++i) {
+        map.insert(i * 3, int64_t(i));
+    }
+    EXPECT_THROW(map.insert(1000000, 1), std::runtime_error);
+    const size_t count = map.size();
+    map = map_t();
+    EXPECT_THROW(map_t::rehash(file, count), std::runtime_error);
+    map_t::rehash(file, 3 * count);
+
+    map = map_t(file);
+    EXPECT_TRUE(map.capacity() == 16384) << map.capacity();
+    EXPECT_TRUE(map.size() == count) << map.size() << " != " << count;
+    int64_t value = 0;
+    EXPECT_TRUE(map.find(5000, value) && value == 1) << value;
+    EXPECT_TRUE(map.find(7, value) && value == int64_t(10 * process_count * thread_count)) << value;
+    EXPECT_TRUE(map.insert(1000000, 1));
+
+    EXPECT_THROW((mfcnt::mmap_concurrent_hash_map<uint32_t, int64_t>(file)), std::runtime_error);
+}
+
+TEST(mfcnt, concurrent_hash_map_narrow_value)
+{
+    using map_t = mfcnt::mmap_concurrent_hash_map<uint64_t, int32_t>;
+
+    const std::string file = (mfcnt_env::test_file().parent_path() / "concurrent_hash_narrow_file").string();
+    map_t::create(file, 16);
+    map_t map(file);
+
+    // The borrow and the carry of the narrow value do not change the unused bytes of the slot.
+    EXPECT_TRUE(map.fetch_add(1, -1) == 0);
+    EXPECT_TRUE(map.fetch_add(1, -1) == -1);
+    int32_t expected = -2;
+    EXPECT_TRUE(map.compare_exchange(1, expected, std::numeric_limits<int32_t>::max()));
+    EXPECT_TRUE(map.fetch_add(1, 1) == std::numeric_limits<int32_t>::max());
+    expected = std::numeric_limits<int32_t>::min();
+    EXPECT_TRUE(map.compare_exchange(1, expected, 5)) << expected;
+    int32_t value = 0;
+    EXPECT_TRUE(map.find(1, value) && value == 5) << value;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&map]() {
+            for (size_t i = 0; i < 10000; ++i) {
+                map.fetch_add(2, (i % 2 == 0) ? -3 : 1);
+            }
+        });
+    }
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    expected = -4 * 10000;
+    EXPECT_TRUE(map.compare_exchange(2, expected, 0)) << expected;
+}
+
+TEST(mfcnt, concurrent_hash_map_insert_race)
+{
+    using map_t = mfcnt::mmap_concurrent_hash_map<uint64_t, int64_t>;
+
+    const std::filesystem::path dir = mfcnt_env::test_file().parent_path();
+    const std::string file = (dir / "insert_race_file").string();
+    const std::string wins_file = (dir / "insert_wins_file").string();
+    const size_t key_count = 100000;
+    const size_t process_count = 4;
+    const size_t thread_count = 4;
+    const int64_t inserted_value = 1000;
+    map_t::create(file, 2 * key_count);
+    map_t::create(wins_file, 2 * key_count);
+
+    // The processes wait on the pipe, so the inserts and the increments of the same keys overlap.
+    int start[2];
+    ASSERT_TRUE(::pipe(start) == 0);
+    std::vector<pid_t> children;
+    for (size_t p = 0; p < process_count; ++p) {
+        const pid_t pid = ::fork();
+        ASSERT_TRUE(pid != -1);
+        if (pid == 0) {
+            ::close(start[1]);
+            map_t map(file);
+            map_t wins(wins_file);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < thread_count; ++t) {
+                threads.emplace_back([&map, &wins, &start, p, key_count, inserted_value]() {
+                    char c;
+                    (void)::read(start[0], &c, 1);
+                    for (size_t i = 0; i < key_count; ++i) {
+                        if (p % 2 == 0) {
+                            if (map.insert(i, inserted_value)) {
+                                wins.fetch_add(i, 1);
+                            }
+                        } else {
+                            map.fetch_add(i, 1);
+                        }
+                    }
+                });
+            }
+            for (std::thread& th : threads) {
+                th.join();
+            }
+            ::_exit(0);
+        }
+        children.push_back(pid);
+    }
+    ::close(start[0]);
+    ::close(start[1]);
+    for (const pid_t pid : children) {
+        int status = 0;
+        ASSERT_TRUE(::waitpid(pid, &status, 0) == pid);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << status;
+    }
+
+    // Each increment is kept, the value is stored only by the insert that has reported it.
+    const map_t map(file);
+    const map_t wins(wins_file);
+    const int64_t add_count = (process_count / 2) * thread_count;
+    ASSERT_TRUE(map.size() == key_count) << map.size() << " != " << key_count;
+    for (size_t i = 0; i < key_count; ++i) {
+        int64_t value = 0;
+        int64_t win_count = 0;
+        ASSERT_TRUE(map.find(i, value)) << "key " << i;
+        wins.find(i, win_count);
+        EXPECT_TRUE(win_count <= 1) << "key " << i << ": " << win_count << " inserts";
+        EXPECT_TRUE(value == add_count + win_count * inserted_value) << "key " << i << ": " << value;
+    }
+}
+
+TEST(mfcnt, btree)
+{
+    using tree_t = mfcnt::mmap_btree<uint64_t, record>;
+
+    const std::string file = (mfcnt_env::test_file().parent_path() / "btree_file").string();
+    std::filesystem::remove(file);
+
+    // The default constructed tree is empty.
+    const tree_t none;
+    EXPECT_FALSE(none.is_open());
+    EXPECT_TRUE(none.empty() && none.size() == 0 && none.height() == 0);
+    EXPECT_TRUE(none.begin() == none.end());
+    EXPECT_TRUE(none.find(1) == none.end());
+    EXPECT_TRUE(none.upper_bound(1) == none.end());
+    EXPECT_FALSE(none.contains(1));
+
+    const auto check = [](const tree_t& tree, const std::map<uint64_t, record>& expected) {
+        ASSERT_TRUE(tree.size() == expected.size()) << tree.size() << " != " << expected.size();
+        std::map<uint64_t, record>::const_iterator it_exp = expected.begin();
+        for (const std::pair<uint64_t, record>& elem : tree) {
+            ASSERT_TRUE(it_exp != expected.end());
+            ASSERT_TRUE(elem.first == it_exp->first) << elem.first << " != " << it_exp->first;
+            EXPECT_TRUE(elem.second.value == it_exp->second.value) << "key " << elem.first;
+            ++it_exp;
+        }
+        EXPECT_TRUE(it_exp == expected.end());
+    };
+
+    std::mt19937_64 gen(11);
+    std::map<uint64_t, record> expected;
+    {
+        tree_t tree(file);
+        EXPECT_TRUE(tree.empty() && tree.begin() == tree.end());
+        for (size_t i = 0; i < 100000; ++i) {
+            const uint64_t key = gen() % 1000000;
+            const bool inserted = expected.emplace(key, record{i, key, i * 3}).second;
+            EXPECT_TRUE(tree.insert(key, record{i, key, i * 3}) == inserted) << "key " << key;
+        }
+        EXPECT_TRUE(tree.height() >= 2) << tree.height();
+        check(tree, expected);
+    }
+
+    // The tree is persistent, the erased leaves are reused.
+    tree_t tree(file);
+    check(tree, expected);
+    for (size_t i = 0; i < 500000; ++i) {
+        const uint64_t key = gen() % 1000000;
+        EXPECT_TRUE(tree.erase(key) == (expected.erase(key) != 0)) << "key " << key;
+    }
+    EXPECT_FALSE(tree.insert_or_assign(expected.begin()->first, record{0, 0, 7}));
+    expected.begin()->second.value = 7;
+    check(tree, expected);
+
+    for (const uint64_t key : {uint64_t(0), uint64_t(1234), uint64_t(500000), uint64_t(999999), uint64_t(2000000)}) {
+        const std::map<uint64_t, record>::const_iterator lower = expected.lower_bound(key);
+        const tree_t::const_iterator it = tree.lower_bound(key);
+        EXPECT_TRUE((it == tree.end()) == (lower == expected.end())) << "key " << key;
+        if (lower != expected.end()) {
+            EXPECT_TRUE(it->first == lower->first) << it->first << " != " << lower->first;
+        }
+        EXPECT_TRUE(tree.contains(key) == (expected.count(key) != 0)) << "key " << key;
+    }
+    const uint64_t first_key = expected.begin()->first;
+    EXPECT_TRUE(tree.at(first_key).value == 7);
+    EXPECT_TRUE(tree.upper_bound(first_key)->first == std::next(expected.begin())->first);
+    EXPECT_THROW(tree.at(2000000), std::out_of_range);
+
+    const size_t file_size = std::filesystem::file_size(file);
+    for (const std::pair<const uint64_t, record>& elem : expected) {
+        EXPECT_TRUE(tree.erase(elem.first));
+    }
+    EXPECT_TRUE(tree.empty() && tree.height() == 0 && tree.begin() == tree.end());
+    for (uint64_t key = 0; key < 100000; ++key) {
+        tree.insert(key, record{key, key, key});
+    }
+    EXPECT_TRUE(std::filesystem::file_size(file) == file_size) << std::filesystem::file_size(file);
+    EXPECT_TRUE(std::distance(tree.lower_bound(1000), tree.lower_bound(2000)) == 1000);
+
+    EXPECT_THROW((mfcnt::mmap_btree<uint32_t, record>(file)), std::runtime_error);
+}
+
+TEST(mfcnt, append_log)
+{
+    const std::string file = (mfcnt_env::test_file().parent_path() / "append_log_file").string();
+    std::filesystem::remove(file);
+
+    const size_t thread_count = 4;
+    const size_t record_count = 20000;
+    const auto payload = [](size_t thread, size_t i) {
+        return std::to_string(thread) + ":" + std::to_string(i) + std::string(i % 50, 'x');
+    };
+    const auto parse = [](const mfcnt::mmap_record& rec) {
+        const std::string s(rec.begin(), rec.end());
+        const size_t colon = s.find(':');
+        return std::make_pair(std::stoul(s.substr(0, colon)), std::stoul(s.substr(colon + 1)));
+    };
+
+    // The log is neither copyable nor movable, it is reopened in place.
+    std::optional<mfcnt::mmap_append_log> log;
+    log.emplace(file, 4 * 1024 * 1024);
+    EXPECT_TRUE(log->capacity() == 4 * 1024 * 1024);
+
+    // The reader follows the writers and sees only the complete records.
+    std::atomic<bool> done(false);
+    std::vector<size_t> seen(thread_count, 0);
+    std::thread reader([&]() {
+        const mfcnt::mmap_log_view<4096> view(file);
+        size_t offset = 0;
+        for (bool last = false; ! last; ) {
+            last = done.load();
+            offset = view.read(offset, [&](const mfcnt::mmap_record& rec) {
+                const std::pair<size_t, size_t> id = parse(rec);
+                EXPECT_TRUE(std::string(rec.begin(), rec.end()) == payload(id.first, id.second));
+                ++seen[id.first];
+            });
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < thread_count; ++t) {
+        writers.emplace_back([&log, &payload, t]() {
+            for (size_t i = 0; i < record_count; ++i) {
+                const std::string data = payload(t, i);
+                if (i % 2 == 0) {
+                    EXPECT_TRUE(log->append(data.data(), data.size()));
+                } else {
+                    const mfcnt::mmap_log_reservation res = log->reserve(data.size());
+                    ASSERT_TRUE(res.data != nullptr);
+                    std::memcpy(res.data, data.data(), data.size());
+                    log->commit(res);
+                }
+            }
+        });
+    }
+    for (std::thread& th : writers) {
+        th.join();
+    }
+    done = true;
+    reader.join();
+    for (size_t t = 0; t < thread_count; ++t) {
+        EXPECT_TRUE(seen[t] == record_count) << seen[t] << " != " << record_count;
+    }
+
+    // The reservation that is not committed stops the readers, it is skipped
+    // when the log is reopened and the records committed after it are kept.
+    const size_t before = log->size();
+    const mfcnt::mmap_log_reservation lost = log->reserve(100);
+    ASSERT_TRUE(lost.data != nullptr);
+    std::memset(lost.data, 'z', 100);
+    EXPECT_TRUE(log->append("after", 5));
+    const size_t size = log->size();
+    const mfcnt::mmap_log_view<> view(file);
+    size_t count = 0;
+    EXPECT_TRUE(view.read(0, [&count](const mfcnt::mmap_record&) { ++count; }) == before);
+    EXPECT_TRUE(count == thread_count * record_count) << count;
+    log.reset();
+    log.emplace(file, 0);
+    EXPECT_TRUE(log->size() == size) << log->size() << " != " << size;
+    std::string last;
+    EXPECT_TRUE(view.read(before, [&last](const mfcnt::mmap_record& r) { last.assign(r.begin(), r.end()); }) == size);
+    EXPECT_TRUE(last == "after") << last;
+
+    // The log is filled up, the readers stop at its end.
+    const std::string big(100000, 'b');
+    while (log->append(big.data(), big.size())) {
+    }
+    EXPECT_FALSE(log->append("x", 1));
+    EXPECT_TRUE(log->size() == log->capacity());
+    mfcnt::mmap_record rec;
+    const size_t end = view.read(size, [&big](const mfcnt::mmap_record& r) {
+        EXPECT_TRUE(std::string(r.begin(), r.end()) == big);
+    });
+    EXPECT_FALSE(view.next(end, rec));
+    EXPECT_TRUE(end + 100008 > log->capacity()) << end;
+}
+
 int main(int /*argc*/, char** /*argv*/)
 {
     ::testing::AddGlobalTestEnvironment(new mfcnt_env());